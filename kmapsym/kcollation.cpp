@@ -0,0 +1,138 @@
+/*
+ * KCollation
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "kcollation.h"
+
+#include <algorithm>
+
+#include <cstring>
+
+/**
+ * Sort key of a name
+ */
+struct SortKey
+{
+    uint64_t prefix;    ///< first 8 case-folded bytes packed in big-endian
+    uint32_t ofs;       ///< offset to the case-folded name
+    uint32_t pos;       ///< index to the name
+};
+
+KCollation::KCollation( Fold fold )
+{
+    for( int ch = 0; ch < 256; ch++ )
+    {
+        _table[ ch ] = ch;
+
+        if( fold == Fold::Upper && ch >= 'a' && ch <= 'z')
+            _table[ ch ] = ch - 'a' + 'A';
+        else if( fold == Fold::Lower && ch >= 'A' && ch <= 'Z')
+            _table[ ch ] = ch - 'A' + 'a';
+    }
+}
+
+int KCollation::compareFolded( std::string_view a, std::string_view b ) const
+{
+    size_t len = std::min( a.size(), b.size());
+
+    for( size_t i = 0; i < len; i++ )
+    {
+        int ca = fold( a[ i ]);
+        int cb = fold( b[ i ]);
+
+        if( ca != cb )
+            return ca - cb;
+    }
+
+    return a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+}
+
+int KCollation::compare( std::string_view a, std::string_view b ) const
+{
+    int cmp = compareFolded( a, b );
+
+    return cmp != 0 ? cmp : a.compare( b );
+}
+
+std::vector< uint32_t >
+KCollation::sort( const std::vector< std::string_view >& names ) const
+{
+    size_t total = 0;
+
+    for( const auto& name: names )
+        total += name.size();
+
+    // case-fold all the names at once
+    std::vector< unsigned char > folded( total );
+    std::vector< SortKey > keys( names.size());
+
+    uint32_t ofs = 0;
+
+    for( uint32_t pos = 0; pos < names.size(); pos++ )
+    {
+        const auto& name = names[ pos ];
+        auto dst = folded.data() + ofs;
+        uint64_t prefix = 0;
+
+        for( size_t i = 0; i < name.size(); i++ )
+        {
+            dst[ i ] = fold( name[ i ]);
+
+            if( i < 8 )
+                prefix |= static_cast< uint64_t >( dst[ i ]) << ( 56 - i * 8 );
+        }
+
+        keys[ pos ] = { prefix, ofs, pos };
+
+        ofs += name.size();
+    }
+
+    std::sort( keys.begin(), keys.end(),
+               [ & ]( const SortKey& a, const SortKey& b )
+    {
+        if( a.prefix != b.prefix )
+            return a.prefix < b.prefix;
+
+        auto la = names[ a.pos ].size();
+        auto lb = names[ b.pos ].size();
+
+        // first 8 bytes are same, compare the rest
+        if( la > 8 && lb > 8 )
+        {
+            int cmp = std::memcmp( folded.data() + a.ofs + 8,
+                                   folded.data() + b.ofs + 8,
+                                   std::min( la, lb ) - 8 );
+            if( cmp != 0 )
+                return cmp < 0;
+        }
+
+        if( la != lb )
+            return la < lb;
+
+        // same after case-folding, compare as they are
+        int cmp = names[ a.pos ].compare( names[ b.pos ]);
+        if( cmp != 0 )
+            return cmp < 0;
+
+        return a.pos < b.pos;
+    });
+
+    std::vector< uint32_t > order( keys.size());
+
+    for( size_t i = 0; i < keys.size(); i++ )
+        order[ i ] = keys[ i ].pos;
+
+    return order;
+}
@@ -0,0 +1,118 @@
+/*
+ * KCollation
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KCOLLATION_H
+#define KMAPSYM_KCOLLATION_H
+
+#include <string_view>
+#include <vector>
+
+#include <cstdint>
+
+/**
+ * Case-insensitive collation of symbol names
+ *
+ * Names are compared after case-folding, and the names equal after
+ * case-folding are compared as they are. The names equal even so keep their
+ * original order.
+ */
+class KCollation
+{
+public:
+    /**
+     * Case-folding
+     */
+    enum class Fold
+    {
+        Upper,  ///< convert to uppercase
+        Lower   ///< convert to lowercase
+    };
+
+    /**
+     * Constructor
+     *
+     * @param[in] fold  Case-folding to use
+     */
+    explicit KCollation( Fold fold );
+
+    /**
+     * Fold a character
+     *
+     * @param[in] ch    Character to fold
+     * @return          Case-folded @p ch
+     */
+    unsigned char fold( unsigned char ch ) const { return _table[ ch ]; }
+
+    /**
+     * Compare two names after case-folding only
+     *
+     * @param[in] a     Name to compare
+     * @param[in] b     Name to compare
+     * @return          negative if @p a < @p b, 0 if @p a == @p b,
+     *                  positive if @p a > @p b
+     */
+    int compareFolded( std::string_view a, std::string_view b ) const;
+
+    /**
+     * Compare two names
+     *
+     * @param[in] a     Name to compare
+     * @param[in] b     Name to compare
+     * @return          negative if @p a < @p b, 0 if @p a == @p b,
+     *                  positive if @p a > @p b
+     */
+    int compare( std::string_view a, std::string_view b ) const;
+
+    /**
+     * Sort names
+     *
+     * @param[in] names Names to sort
+     * @return          Indexes to @p names in sorted order
+     */
+    std::vector< uint32_t >
+    sort( const std::vector< std::string_view >& names ) const;
+
+    /**
+     * Sort a list of indexes by names
+     *
+     * @param[in,out] order     Indexes to sort
+     * @param[in]     nameOf    Function returning the name of an index
+     */
+    template< typename Index, typename NameOf >
+    void sort( std::vector< Index >& order, NameOf nameOf ) const
+    {
+        std::vector< std::string_view > names;
+
+        names.reserve( order.size());
+        for( auto i: order )
+            names.push_back( nameOf( i ));
+
+        auto perm = sort( names );
+
+        std::vector< Index > sorted;
+
+        sorted.reserve( order.size());
+        for( auto p: perm )
+            sorted.push_back( order[ p ]);
+
+        order.swap( sorted );
+    }
+
+private:
+    unsigned char _table[ 256 ];    ///< case-folding table
+};
+
+#endif
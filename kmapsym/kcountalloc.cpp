@@ -0,0 +1,80 @@
+/*
+ * Heap allocation counting
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file
+ *
+ * Replaces global operator new() and operator delete() to count heap
+ * allocations. Link this file to make KStats report them.
+ */
+
+#include "kstats.h"
+
+#include <new>
+
+#include <cstdlib>
+
+/// heap allocation counters. Constant-initialized, so usable before main()
+static KStats::HeapCounters heap;
+
+/// register the counters before main()
+static const bool registered = ( KStats::setHeapCounters( &heap ), true );
+
+/// size of the header keeping the size of an allocation
+static constexpr size_t AllocHeaderSize = alignof( std::max_align_t );
+
+/**
+ * Allocate memory, and count it
+ */
+void *operator new( size_t size )
+{
+    auto p = static_cast< char * >( std::malloc( size + AllocHeaderSize ));
+    if( !p )
+        throw std::bad_alloc();
+
+    *reinterpret_cast< size_t * >( p ) = size;
+
+    heap.allocs++;
+
+    auto cur = heap.curBytes += size;
+    auto peak = heap.peakBytes.load();
+
+    while( cur > peak && !heap.peakBytes.compare_exchange_weak( peak, cur ))
+        /* nothing */;
+
+    return p + AllocHeaderSize;
+}
+
+/**
+ * Free memory allocated by operator new(), and count it
+ */
+void operator delete( void *ptr ) noexcept
+{
+    if( !ptr )
+        return;
+
+    auto p = static_cast< char * >( ptr ) - AllocHeaderSize;
+
+    heap.frees++;
+    heap.curBytes -= *reinterpret_cast< size_t * >( p );
+
+    std::free( p );
+}
+
+/**
+ * Free memory allocated by operator new(), and count it
+ */
+void operator delete( void *ptr, size_t ) noexcept
+{
+    operator delete( ptr );
+}
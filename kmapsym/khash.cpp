@@ -0,0 +1,139 @@
+/*
+ * KHash
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "khash.h"
+
+#include <cstring>
+
+static constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ULL;   ///< XXH64 prime 1
+static constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;   ///< XXH64 prime 2
+static constexpr uint64_t Prime3 = 0x165667B19E3779F9ULL;   ///< XXH64 prime 3
+static constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;   ///< XXH64 prime 4
+static constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ULL;   ///< XXH64 prime 5
+
+/**
+ * Rotate left
+ */
+static inline uint64_t rotl( uint64_t x, int r )
+{
+    return ( x << r ) | ( x >> ( 64 - r ));
+}
+
+/**
+ * Read a little-endian 64-bit value
+ */
+static inline uint64_t read64( const unsigned char *p )
+{
+    uint64_t v = 0;
+
+    for( int i = 7; i >= 0; i-- )
+        v = ( v << 8 ) | p[ i ];
+
+    return v;
+}
+
+/**
+ * Read a little-endian 32-bit value
+ */
+static inline uint32_t read32( const unsigned char *p )
+{
+    return p[ 0 ] | ( p[ 1 ] << 8 ) | ( p[ 2 ] << 16 )
+           | ( static_cast< uint32_t >( p[ 3 ]) << 24 );
+}
+
+/**
+ * Mix a lane
+ */
+static inline uint64_t round( uint64_t acc, uint64_t input )
+{
+    acc += input * Prime2;
+    acc = rotl( acc, 31 );
+
+    return acc * Prime1;
+}
+
+/**
+ * Merge a lane into the hash
+ */
+static inline uint64_t mergeRound( uint64_t acc, uint64_t val )
+{
+    acc ^= round( 0, val );
+
+    return acc * Prime1 + Prime4;
+}
+
+uint64_t KHash::xxh64( const void *data, size_t len, uint64_t seed )
+{
+    auto p = static_cast< const unsigned char * >( data );
+    auto end = p + len;
+    uint64_t h;
+
+    if( len >= 32 )
+    {
+        uint64_t v1 = seed + Prime1 + Prime2;
+        uint64_t v2 = seed + Prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - Prime1;
+
+        // 4 lanes of 8 bytes
+        for( ; p + 32 <= end; p += 32 )
+        {
+            v1 = round( v1, read64( p ));
+            v2 = round( v2, read64( p + 8 ));
+            v3 = round( v3, read64( p + 16 ));
+            v4 = round( v4, read64( p + 24 ));
+        }
+
+        h = rotl( v1, 1 ) + rotl( v2, 7 ) + rotl( v3, 12 ) + rotl( v4, 18 );
+        h = mergeRound( h, v1 );
+        h = mergeRound( h, v2 );
+        h = mergeRound( h, v3 );
+        h = mergeRound( h, v4 );
+    }
+    else
+        h = seed + Prime5;
+
+    h += len;
+
+    // the rest
+    for( ; p + 8 <= end; p += 8 )
+    {
+        h ^= round( 0, read64( p ));
+        h = rotl( h, 27 ) * Prime1 + Prime4;
+    }
+
+    if( p + 4 <= end )
+    {
+        h ^= read32( p ) * Prime1;
+        h = rotl( h, 23 ) * Prime2 + Prime3;
+        p += 4;
+    }
+
+    for( ; p < end; p++ )
+    {
+        h ^= *p * Prime5;
+        h = rotl( h, 11 ) * Prime1;
+    }
+
+    // avalanche
+    h ^= h >> 33;
+    h *= Prime2;
+    h ^= h >> 29;
+    h *= Prime3;
+    h ^= h >> 32;
+
+    return h;
+}
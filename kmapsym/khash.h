@@ -0,0 +1,54 @@
+/*
+ * KHash
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KHASH_H
+#define KMAPSYM_KHASH_H
+
+#include <string_view>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Non-cryptographic hash functions
+ */
+class KHash
+{
+public:
+    /**
+     * Calculate XXH64 hash of data
+     *
+     * @param[in] data  Data to hash
+     * @param[in] len   Length of @p data in bytes
+     * @param[in] seed  Seed
+     * @return          XXH64 hash
+     */
+    static uint64_t xxh64( const void *data, size_t len, uint64_t seed = 0 );
+
+    /**
+     * Calculate XXH64 hash of a string
+     *
+     * @param[in] s     String to hash
+     * @param[in] seed  Seed
+     * @return          XXH64 hash
+     */
+    static uint64_t xxh64( std::string_view s, uint64_t seed = 0 )
+    {
+        return xxh64( s.data(), s.size(), seed );
+    }
+};
+
+#endif
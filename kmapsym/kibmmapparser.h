@@ -18,8 +18,11 @@
 #define KMAPSYM_KIBMMAPPARSER_H
 
 #include "kmapparser.h"
+#include "ktokenizer.h"
 
 #include <string_view>
+#include <algorithm>
+#include <charconv>
 
 /**
  * IBM .MAP file parser class
@@ -39,14 +42,256 @@ public:
      */
     virtual ~KIbmMapParser();
 
+    /**
+     * Check if a line may be a part of the body of a publics block
+     *
+     * @param[in] line  Line to check
+     * @return          true if @p line may be a part of the body, otherwise
+     *                  false
+     */
+    static bool isPublicsBody( std::string_view line );
+
+    /**
+     * Check if a line may be a part of the body of a block to skip
+     *
+     * @param[in] st    Parser state of the block
+     * @param[in] line  Line to check
+     * @return          true if @p line cannot start another block,
+     *                  otherwise false
+     * @remark          Called for every line of the blocks skipped, so it
+     *                  looks at the beginning of @p line only
+     */
+    static bool isBlockBody( State st, std::string_view line );
+
+    /**
+     * Parse a line, and pass records to a sink
+     *
+     * @param[in]     line      Line to parse
+     * @param[in]     v         Tokenizer to use
+     * @param[in,out] st        Parser state
+     * @param[in]     sink      Sink to receive records
+     * @return                  true if success, otherwise false
+     */
+    template< typename Sink >
+    static bool parseLineTo( std::string_view line, KTokenizer& v, State& st,
+                             Sink& sink );
+
 private:
     /**
-     * Line parser
+     * Parse a .MAP file, and pass records to the callbacks
      *
-     * @param[in] line  Line to parse
-     * @return          true if success, otherwise false
+     * @return true if success, otherwise false
      */
-    bool parseLine( std::string_view line ) override;
+    bool parseRecords() override;
 };
 
+template< typename Sink >
+bool KIbmMapParser::parseLineTo( std::string_view line, KTokenizer& v,
+                                 State& st, Sink& sink )
+{
+    if( line.empty())
+        return true;
+
+    // split by space
+    v.split( line );
+
+    if( v.size() == 0 )
+        return true;
+
+    if( !v.leadingSpace())
+    {
+        if( startsWith( line, "Program entry point at "))
+            sink.entry( v.back());
+        else if( startsWith( line, "Line numbers for "))
+        {
+            // Line numbers for obj(source) segment seg
+            auto name = line.substr( 17 );
+
+            name.remove_prefix( std::min( name.find_first_not_of(' '),
+                                          name.size()));
+
+            auto segPos = name.rfind(" segment ");
+            if( segPos != std::string_view::npos )
+                name = name.substr( 0, segPos );
+
+            // take the source file name if any
+            auto lparen = name.find('(');
+            if( lparen != std::string_view::npos && name.back() == ')')
+                name = name.substr( lparen + 1, name.size() - lparen - 2 );
+
+            sink.lineFile( name );
+            st = State::LineNumbers;
+        }
+
+        return true;
+    }
+    else if( v.front().compare("Start") == 0 )
+        st = State::Segments;
+    else if( v.front().compare("Origin") == 0 )
+        st = State::Groups;
+    else if( v.back().compare("Name") == 0 )
+        st = State::PublicsByName;
+    else if( v.back().compare("Value") == 0 )
+        st = State::PublicsByValue;
+    else
+    {
+        switch( st )
+        {
+            case State::Segments:
+            {
+                if( v.size() < 4 || v.size() > 5)
+                    return false;
+
+                // remove 'H' at the end
+                if( v[ 1 ].back() == 'H')
+                    v[ 1 ].remove_suffix( 1 );
+
+                int nBits = 0;  // unknown
+
+                if( v.size() > 4 )
+                {
+                    if( v[ 4 ].compare("32-bit") == 0 )
+                        nBits = 32;
+                    else  if( v[ 4 ].compare("16-bit") == 0 )
+                        nBits = 16;
+                }
+                else if( v[ 0 ].size() == 13 )
+                    nBits = 32;
+                else if( v[ 0 ].size() == 9 )
+                    nBits = 16;
+
+                if( nBits == 0 )
+                    return false;
+
+                Addr addr;
+                uint32_t length;
+
+                if( !parseAddr( v[ 0 ], addr ) || !parseHex( v[ 1 ], length ))
+                    return false;
+
+                sink.segment({ addr, length, v[ 2 ], v[ 3 ], nBits });
+                break;
+            }
+
+            case State::Groups:
+            {
+                if( v.size() != 2 )
+                    return false;
+
+                Addr addr;
+
+                if( !parseAddr( v[ 0 ], addr ))
+                    return false;
+
+                sink.group({ addr, 0, v[ 1 ]});
+                break;
+            }
+
+            case State::PublicsByName:
+            case State::PublicsByValue:
+            {
+                Addr addr;
+                std::string_view name;
+
+                if( !parseAddr( v[ 0 ], addr ))
+                    return false;
+
+                switch( v.size())
+                {
+                    case 2:
+                        name = v[ 1 ];
+                        break;
+
+                    case 3:
+                        if( v[ 1 ].compare("Abs") != 0 )
+                            return false;
+
+                        name = v[ 2 ];
+                        break;
+
+                    case 4:
+                    {
+                        if( v[ 1 ].compare("Imp") != 0 )
+                            return false;
+
+                        // remove '(' at the beginning
+                        if( v[ 3 ].front() == '(')
+                            v[ 3 ].remove_prefix( 1 );
+
+                        // remove ')' at the end
+                        if( v[ 3 ].back() == ')')
+                            v[ 3 ].remove_suffix( 1 );
+
+                        size_t dotPos = v[ 3 ].find_first_of('.');
+
+                        sink.import({ addr, v[ 2 ],
+                                   v[ 3 ].substr( 0, dotPos ),
+                                   v[ 3 ].substr( dotPos + 1 )});
+
+                        return true;
+                    }
+
+                    default:
+                        return false;
+                }
+
+                sink.publicSym({ addr, name }, st );
+                break;
+            }
+
+            case State::LineNumbers:
+            {
+                // pairs of line number and address
+                if( v.size() % 2 != 0 )
+                    return false;
+
+                static_assert( KTokenizer::MaxTokens % 2 == 0,
+                               "Pairs should not straddle chunks");
+
+                // walk a long row in chunks of tokens kept by v
+                for(;;)
+                {
+                    size_t n = std::min( v.size(), KTokenizer::MaxTokens );
+
+                    for( size_t i = 0; i < n; i += 2 )
+                    {
+                        uint32_t lineNum;
+                        Addr addr;
+
+                        auto end = v[ i ].data() + v[ i ].size();
+                        auto res = std::from_chars( v[ i ].data(), end,
+                                                    lineNum );
+
+                        if( res.ec != std::errc() || res.ptr != end
+                            || !parseAddr( v[ i + 1 ], addr ))
+                            return false;
+
+                        sink.lineNumber( lineNum, addr );
+                    }
+
+                    if( v.size() <= KTokenizer::MaxTokens )
+                        break;
+
+                    // split the rest after the last token kept
+                    const auto& last = v[ KTokenizer::MaxTokens - 1 ];
+
+                    v.split( line.substr( last.data() + last.size()
+                                          - line.data()));
+                }
+                break;
+            }
+
+            case State::None:
+                sink.module( line.substr( 1 ));
+                // fall through
+
+            default:
+                // ignore
+                break;
+        }
+    }
+
+    return true;
+}
+
 #endif
@@ -0,0 +1,136 @@
+/*
+ * KLineTable
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "klinetable.h"
+
+#include <algorithm>
+
+#include <cstring>
+
+KLineTable::~KLineTable()
+{
+    if( _spill )
+        std::fclose( _spill );
+}
+
+void KLineTable::clear()
+{
+    _files.clear();
+    _stream.clear();
+    _size = 0;
+    _fileName = {};
+    _newFile = false;
+
+    if( _spill )
+        std::fclose( _spill );
+
+    _spill = nullptr;
+    _spilled = 0;
+}
+
+void KLineTable::addFile( std::string_view name )
+{
+    _fileName = name;
+
+    // the entry is added with the first line
+    _newFile = true;
+}
+
+void KLineTable::addLine( uint32_t line, uint32_t segNum, uint32_t ofs )
+{
+    if( _newFile || _files.empty() || _files.back().segNum != segNum )
+    {
+        _files.push_back({ _fileName, segNum, 0, 0,
+                           _spilled + _stream.size(), 0 });
+
+        _newFile = false;
+        _lastLine = 0;
+        _lastOfs = 0;
+    }
+
+    putVarint( zigzag( line - _lastLine ));
+    putVarint( zigzag( ofs - _lastOfs ));
+
+    _lastLine = line;
+    _lastOfs = ofs;
+
+    auto& file = _files.back();
+
+    file.count++;
+    if( line > 0xFFFF )
+        file.nWide++;
+    file.bytes = _spilled + _stream.size() - file.start;
+    _size++;
+
+    if( _spillSize > 0 && _stream.size() >= _spillSize )
+        spill();
+}
+
+void KLineTable::spill()
+{
+    if( !_spill )
+        _spill = std::tmpfile();
+
+    // append even after reading
+    if( !_spill || std::fseek( _spill, 0, SEEK_END ) != 0
+        || std::fwrite( _stream.data(), 1, _stream.size(), _spill )
+            != _stream.size())
+    {
+        // keep in memory
+        _spillSize = 0;
+
+        return;
+    }
+
+    _spilled += _stream.size();
+    _stream.clear();
+}
+
+const uint8_t *KLineTable::encoded( const File& file,
+                                    std::vector< uint8_t >& buf ) const
+{
+    // all in memory ?
+    if( file.start >= _spilled )
+        return _stream.data() + file.start - _spilled;
+
+    buf.resize( file.bytes );
+
+    size_t inFile = std::min( file.bytes, _spilled - file.start );
+
+    // read zeros on error, which are decoded to zeros
+    if( std::fseek( _spill, static_cast< long >( file.start ),
+                    SEEK_SET ) != 0
+        || std::fread( buf.data(), 1, inFile, _spill ) != inFile )
+        std::memset( buf.data(), 0, inFile );
+
+    // the rest is in memory
+    if( file.bytes > inFile )
+        std::memcpy( buf.data() + inFile, _stream.data(),
+                     file.bytes - inFile );
+
+    return buf.data();
+}
+
+void KLineTable::putVarint( uint32_t u )
+{
+    while( u >= 0x80 )
+    {
+        _stream.push_back( static_cast< uint8_t >( u | 0x80 ));
+        u >>= 7;
+    }
+
+    _stream.push_back( static_cast< uint8_t >( u ));
+}
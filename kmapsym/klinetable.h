@@ -0,0 +1,215 @@
+/*
+ * KLineTable
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KLINETABLE_H
+#define KMAPSYM_KLINETABLE_H
+
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Compact table of source line numbers
+ *
+ * Lines are grouped by source file and segment, and each line is stored as
+ * the differences of its line number and offset from the previous line in
+ * variable-length integers. Usually it takes 2 or 3 bytes per line.
+ */
+class KLineTable
+{
+public:
+    /**
+     * Lines of a source file in a segment
+     */
+    struct File
+    {
+        std::string_view name;  ///< source file name
+        uint32_t segNum;        ///< segment number
+        size_t count;           ///< # of lines
+        size_t nWide;           ///< # of lines whose numbers exceed 16 bits
+        size_t start;           ///< offset of the first line in the stream
+        size_t bytes;           ///< size of the lines in the stream
+    };
+
+    /**
+     * Constructor
+     */
+    KLineTable() = default;
+
+    /**
+     * Destructor
+     */
+    ~KLineTable();
+
+    /**
+     * Copy constructor
+     */
+    KLineTable( const KLineTable& ) = delete;
+
+    /**
+     * operator=
+     */
+    KLineTable& operator=( const KLineTable& ) = delete;
+
+    /**
+     * Clear the table
+     */
+    void clear();
+
+    /**
+     * Move the stream to a temporary file whenever it grows to a size
+     *
+     * @param[in] bytes Max. size of the stream in memory. 0 to keep all in
+     *                  memory
+     * @remark          If a temporary file cannot be created, the stream is
+     *                  kept in memory
+     */
+    void setSpillSize( size_t bytes ) { _spillSize = bytes; }
+
+    /**
+     * Start lines of a source file
+     *
+     * @param[in] name  Source file name. Should be valid while the table is
+     *                  used
+     */
+    void addFile( std::string_view name );
+
+    /**
+     * Add a line to the current source file
+     *
+     * @param[in] line      Line number
+     * @param[in] segNum    Segment number
+     * @param[in] ofs       Offset in the segment
+     * @remark              Starts another entry of the same source file, if
+     *                      @p segNum differs from the previous line
+     */
+    void addLine( uint32_t line, uint32_t segNum, uint32_t ofs );
+
+    /**
+     * Get the source files
+     */
+    const std::vector< File >& files() const { return _files; }
+
+    /**
+     * Get the # of lines of all the source files
+     */
+    size_t size() const { return _size; }
+
+    /**
+     * Check if there is no line
+     */
+    bool empty() const { return _size == 0; }
+
+    /**
+     * Decode lines of a source file
+     *
+     * @param[in] file  Source file
+     * @param[in] f     Function called with a line number and an offset for
+     *                  each line in order of addition
+     */
+    template< typename F >
+    void forEachLine( const File& file, F f ) const
+    {
+        std::vector< uint8_t > buf;
+        const uint8_t *p = encoded( file, buf );
+        uint32_t line = 0;
+        uint32_t ofs = 0;
+
+        for( size_t i = 0; i < file.count; i++ )
+        {
+            line += unzigzag( getVarint( p ));
+            ofs += unzigzag( getVarint( p ));
+
+            f( line, ofs );
+        }
+    }
+
+private:
+    std::vector< File > _files;     ///< source files
+    std::vector< uint8_t > _stream; ///< encoded lines
+    size_t _size = 0;               ///< # of lines
+
+    std::string_view _fileName;     ///< current source file name
+    bool _newFile = false;          ///< no lines of the current file yet
+    uint32_t _lastLine = 0;         ///< line number of the previous line
+    uint32_t _lastOfs = 0;          ///< offset of the previous line
+
+    size_t _spillSize = 0;          ///< max. size of the stream in memory
+    std::FILE *_spill = nullptr;    ///< file of the stream moved
+    size_t _spilled = 0;            ///< size of the stream moved
+
+    /**
+     * Move the stream to the temporary file
+     */
+    void spill();
+
+    /**
+     * Get the encoded lines of a source file
+     *
+     * @param[in]  file Source file
+     * @param[out] buf  Buffer to read the lines moved to the file into
+     * @return          Encoded lines in the stream or in @p buf
+     */
+    const uint8_t *encoded( const File& file,
+                            std::vector< uint8_t >& buf ) const;
+
+    /**
+     * Append a variable-length integer, 7 bits per byte from LSB
+     */
+    void putVarint( uint32_t u );
+
+    /**
+     * Read a variable-length integer
+     *
+     * @param[in,out] p     Position to read from. Advanced past the integer
+     */
+    static uint32_t getVarint( const uint8_t *& p )
+    {
+        uint32_t u = 0;
+
+        for( int shift = 0; ; shift += 7 )
+        {
+            uint8_t b = *p++;
+
+            u |= static_cast< uint32_t >( b & 0x7F ) << shift;
+
+            if( !( b & 0x80 ))
+                return u;
+        }
+    }
+
+    /**
+     * Map a signed difference to an unsigned integer, small magnitudes to
+     * small values
+     */
+    static uint32_t zigzag( uint32_t diff )
+    {
+        return ( diff << 1 ) ^ ( 0 - ( diff >> 31 ));
+    }
+
+    /**
+     * Inverse of zigzag()
+     */
+    static uint32_t unzigzag( uint32_t u )
+    {
+        return ( u >> 1 ) ^ ( 0 - ( u & 1 ));
+    }
+};
+
+#endif
@@ -0,0 +1,337 @@
+/*
+ * KLocalSocket
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "klocalsocket.h"
+
+#include <algorithm>
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/// max. # of digits of the length of a field
+static constexpr size_t MaxLengthDigits = 10;
+
+/**
+ * Fill a socket address with a path
+ *
+ * @param[in]  path  Socket path
+ * @param[out] addr  Socket address
+ * @return           true if success, false if @p path is too long
+ */
+static bool makeAddr( const std::string& path, sockaddr_un& addr )
+{
+    std::memset( &addr, 0, sizeof( addr ));
+
+    if( path.empty() || path.size() >= sizeof( addr.sun_path ))
+        return false;
+
+    addr.sun_family = AF_UNIX;
+    std::memcpy( addr.sun_path, path.c_str(), path.size());
+
+    return true;
+}
+
+/**
+ * Check if a peer runs as the user of this process
+ *
+ * @param[in] fd    Socket connected to the peer
+ * @return          true if the same user or if unknown, otherwise false
+ * @remark          Where a peer cannot be known, the permissions of the
+ *                  socket path protect the server
+ */
+static bool isOwner( [[maybe_unused]] int fd )
+{
+#if defined( __linux__ )
+    ucred cred;
+    socklen_t len = sizeof( cred );
+
+    return getsockopt( fd, SOL_SOCKET, SO_PEERCRED, &cred, &len ) == 0
+           && cred.uid == geteuid();
+#elif defined( __APPLE__ ) || defined( __FreeBSD__ ) \
+      || defined( __NetBSD__ ) || defined( __OpenBSD__ ) \
+      || defined( __DragonFly__ )
+    uid_t uid;
+    gid_t gid;
+
+    return getpeereid( fd, &uid, &gid ) == 0 && uid == geteuid();
+#else
+    return true;
+#endif
+}
+
+KLocalSocket::~KLocalSocket()
+{
+    close();
+}
+
+bool KLocalSocket::listen( const std::string& path )
+{
+    close();
+
+    sockaddr_un addr;
+
+    if( !makeAddr( path, addr ))
+        return false;
+
+    struct stat st;
+
+    // remove a socket left by a server not running any more
+    if( stat( path.c_str(), &st ) == 0 && S_ISSOCK( st.st_mode ))
+    {
+        KLocalSocket probe;
+
+        if( probe.connect( path ))
+            return false;
+
+        unlink( path.c_str());
+    }
+
+    _fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if( _fd == -1 )
+        return false;
+
+    // only the owner may connect
+    mode_t mask = umask( 077 );
+
+    int rc = bind( _fd, reinterpret_cast< sockaddr * >( &addr ),
+                   sizeof( addr ));
+
+    umask( mask );
+
+    if( rc == -1 )
+    {
+        close();
+
+        return false;
+    }
+
+    _path = path;
+
+    if( ::listen( _fd, SOMAXCONN ) == -1 )
+    {
+        close();
+
+        return false;
+    }
+
+    return true;
+}
+
+bool KLocalSocket::wait( int timeoutMs )
+{
+    fd_set fds;
+    timeval tv;
+
+    FD_ZERO( &fds );
+    FD_SET( _fd, &fds );
+
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = ( timeoutMs % 1000 ) * 1000;
+
+    return select( _fd + 1, &fds, nullptr, nullptr, &tv ) > 0;
+}
+
+bool KLocalSocket::waitAny( const std::vector< KLocalSocket * >& sockets,
+                            int timeoutMs, std::vector< bool >& ready )
+{
+    fd_set fds;
+    timeval tv;
+    int maxFd = -1;
+
+    FD_ZERO( &fds );
+
+    for( auto socket: sockets )
+    {
+        FD_SET( socket->_fd, &fds );
+        maxFd = std::max( maxFd, socket->_fd );
+    }
+
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = ( timeoutMs % 1000 ) * 1000;
+
+    bool any = select( maxFd + 1, &fds, nullptr, nullptr, &tv ) > 0;
+
+    ready.assign( sockets.size(), false );
+
+    for( size_t i = 0; any && i < sockets.size(); i++ )
+        ready[ i ] = FD_ISSET( sockets[ i ]->_fd, &fds );
+
+    return any;
+}
+
+bool KLocalSocket::accept( KLocalSocket& peer )
+{
+    peer.close();
+
+    peer._fd = ::accept( _fd, nullptr, nullptr );
+
+    // select() cannot wait for a descriptor out of fd_set
+    if( peer._fd >= FD_SETSIZE || ( peer._fd != -1 && !isOwner( peer._fd )))
+        peer.close();
+
+    return peer._fd != -1;
+}
+
+bool KLocalSocket::connect( const std::string& path )
+{
+    close();
+
+    sockaddr_un addr;
+
+    if( !makeAddr( path, addr ))
+        return false;
+
+    _fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if( _fd == -1 )
+        return false;
+
+    if( ::connect( _fd, reinterpret_cast< sockaddr * >( &addr ),
+                   sizeof( addr )) == -1 )
+    {
+        close();
+
+        return false;
+    }
+
+    return true;
+}
+
+bool KLocalSocket::send( std::string_view data )
+{
+    while( !data.empty())
+    {
+        auto n = ::send( _fd, data.data(), data.size(), 0 );
+        if( n == -1 )
+        {
+            if( errno == EINTR )
+                continue;
+
+            return false;
+        }
+
+        data.remove_prefix( n );
+    }
+
+    return true;
+}
+
+bool KLocalSocket::endSend()
+{
+    return shutdown( _fd, SHUT_WR ) == 0;
+}
+
+bool KLocalSocket::receiveAll( std::string& data )
+{
+    char buf[ 64 * 1024 ];
+
+    data.clear();
+
+    for(;;)
+    {
+        auto n = recv( _fd, buf, sizeof( buf ), 0 );
+        if( n == 0 )
+            return true;
+
+        if( n == -1 )
+        {
+            if( errno == EINTR )
+                continue;
+
+            return false;
+        }
+
+        data.append( buf, n );
+    }
+}
+
+bool KLocalSocket::receive( std::string& data, size_t maxSize, bool& end )
+{
+    char buf[ 64 * 1024 ];
+
+    for(;;)
+    {
+        auto n = recv( _fd, buf, sizeof( buf ), 0 );
+        if( n == -1 )
+        {
+            if( errno == EINTR )
+                continue;
+
+            return false;
+        }
+
+        end = n == 0;
+
+        if( static_cast< size_t >( n ) > maxSize - data.size())
+            return false;
+
+        data.append( buf, n );
+
+        return true;
+    }
+}
+
+void KLocalSocket::close()
+{
+    if( _fd != -1 )
+        ::close( _fd );
+
+    if( !_path.empty())
+        unlink( _path.c_str());
+
+    _fd = -1;
+    _path.clear();
+}
+
+void KLocalSocket::putField( std::string& msg, std::string_view field )
+{
+    msg += std::to_string( field.size());
+    msg += ':';
+    msg += field;
+    msg += ',';
+}
+
+bool KLocalSocket::getField( std::string_view& msg, std::string_view& field )
+{
+    auto colon = msg.find(':');
+    if( colon == 0 || colon == std::string_view::npos
+        || colon > MaxLengthDigits )
+        return false;
+
+    size_t len = 0;
+
+    for( size_t i = 0; i < colon; i++ )
+    {
+        if( msg[ i ] < '0' || msg[ i ] > '9')
+            return false;
+
+        len = len * 10 + ( msg[ i ] - '0');
+    }
+
+    if( msg.size() - colon - 1 <= len || msg[ colon + 1 + len ] != ',')
+        return false;
+
+    field = msg.substr( colon + 1, len );
+    msg.remove_prefix( colon + 1 + len + 1 );
+
+    return true;
+}
@@ -0,0 +1,172 @@
+/*
+ * KLocalSocket
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KLOCALSOCKET_H
+#define KMAPSYM_KLOCALSOCKET_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Stream socket in the local (Unix) domain
+ *
+ * A message is a sequence of fields in the netstring form, that is,
+ * `length:bytes,`. A peer sends a message, and ends sending with
+ * endSend(). The other peer receives it with receiveAll(), or piece by
+ * piece with wait() and receive() not to block.
+ */
+class KLocalSocket
+{
+public:
+    /**
+     * Constructor
+     */
+    KLocalSocket() = default;
+
+    /**
+     * Destructor
+     */
+    ~KLocalSocket();
+
+    /**
+     * Copy constructor
+     */
+    KLocalSocket( const KLocalSocket& ) = delete;
+
+    /**
+     * operator=
+     */
+    KLocalSocket& operator=( const KLocalSocket& ) = delete;
+
+    /**
+     * Listen on a socket path
+     *
+     * @param[in] path  Socket path. A stale socket left there is removed
+     * @return          true if success, otherwise false
+     * @remark          The socket path is removed by close(). Only the
+     *                  owner may connect to it
+     */
+    bool listen( const std::string& path );
+
+    /**
+     * Wait for a connection to a listening socket, or for data to a
+     * connected socket
+     *
+     * @param[in] timeoutMs Time to wait in milliseconds
+     * @return              true if a connection or data is pending,
+     *                      otherwise false
+     */
+    bool wait( int timeoutMs );
+
+    /**
+     * Wait for any of sockets, as wait() does for one
+     *
+     * @param[in]  sockets      Sockets to wait for
+     * @param[in]  timeoutMs    Time to wait in milliseconds
+     * @param[out] ready        true for each socket with a connection or
+     *                          data pending, otherwise false
+     * @return                  true if any socket is ready, otherwise false
+     */
+    static bool waitAny( const std::vector< KLocalSocket * >& sockets,
+                         int timeoutMs, std::vector< bool >& ready );
+
+    /**
+     * Accept a connection to a listening socket
+     *
+     * @param[out] peer Socket connected to the peer
+     * @return          true if success, otherwise false
+     * @remark          Fails if select() cannot wait for the peer, or if
+     *                  the peer runs as another user
+     */
+    bool accept( KLocalSocket& peer );
+
+    /**
+     * Connect to a listening socket
+     *
+     * @param[in] path  Socket path
+     * @return          true if success, otherwise false
+     */
+    bool connect( const std::string& path );
+
+    /**
+     * Send data
+     *
+     * @param[in] data  Data to send
+     * @return          true if success, otherwise false
+     */
+    bool send( std::string_view data );
+
+    /**
+     * End sending, so that the peer receives the end of data
+     *
+     * @return true if success, otherwise false
+     */
+    bool endSend();
+
+    /**
+     * Receive data until the peer ends sending
+     *
+     * @param[out] data Data received
+     * @return          true if success, otherwise false
+     */
+    bool receiveAll( std::string& data );
+
+    /**
+     * Receive a piece of data, blocking if nothing is pending
+     *
+     * @param[in,out] data      Data received. A piece is appended to it
+     * @param[in]     maxSize   Max. size of @p data
+     * @param[out]    end       true if the peer has ended sending
+     * @return                  true if success, false on an error or if
+     *                          @p data would exceed @p maxSize
+     */
+    bool receive( std::string& data, size_t maxSize, bool& end );
+
+    /**
+     * Close a socket
+     */
+    void close();
+
+    /**
+     * Check if a socket is open
+     */
+    bool isOpen() const { return _fd != -1; }
+
+    /**
+     * Append a field to a message
+     *
+     * @param[in,out] msg   Message
+     * @param[in]     field Field to append
+     */
+    static void putField( std::string& msg, std::string_view field );
+
+    /**
+     * Take the first field of a message
+     *
+     * @param[in,out] msg   Message. The field is removed from it
+     * @param[out]    field Field taken. Refers to @p msg
+     * @return              true if success, false at the end or on a
+     *                      malformed field
+     */
+    static bool getField( std::string_view& msg, std::string_view& field );
+
+private:
+    int _fd = -1;           ///< socket descriptor
+    std::string _path;      ///< path of a listening socket
+};
+
+#endif
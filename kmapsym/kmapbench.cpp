@@ -0,0 +1,471 @@
+/*
+ * KMapBench
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file
+ *
+ * Benchmark parsing, sorting and writing of kmapsym, and check the .SYM
+ * files against golden hashes.
+ */
+
+#include "kmapparser.h"
+#include "kibmmapparser.h"
+#include "kwatcommapparser.h"
+#include "ksymwriter.h"
+#include "kmappedfile.h"
+#include "kthreadpool.h"
+#include "khash.h"
+#include "kverbose.h"
+#include "kstats.h"
+
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cstdlib>
+
+#ifndef __OS2__
+#include <sys/resource.h>
+#endif
+
+#define verb KVerbose::instance()
+
+/**
+ * .MAP file to benchmark
+ */
+struct Input
+{
+    std::string file;   ///< .MAP file name
+    bool watcom;        ///< Watcom map file
+};
+
+/**
+ * Options
+ */
+struct Options
+{
+    size_t repeat = 3;              ///< # of runs per file
+    size_t jobs = 0;                ///< # of threads. 0 for # of CPUs
+    std::string golden;             ///< golden hash file. empty for none
+    std::vector< Input > inputs;    ///< .MAP files
+};
+
+/**
+ * Result of a run
+ */
+struct Result
+{
+    uint64_t bytes = 0;     ///< size of .MAP file
+    uint64_t symbols = 0;   ///< # of public symbols
+    uint64_t parseNs = 0;   ///< time to open and parse
+    uint64_t sortNs = 0;    ///< time to sort
+    uint64_t writeNs = 0;   ///< time to lay out and write
+    uint64_t totalNs = 0;   ///< wall time of all
+    uint64_t allocs = 0;    ///< # of heap allocations
+    uint64_t peakHeap = 0;  ///< peak of heap bytes allocated
+};
+
+/**
+ * Show usage
+ */
+static void showUsage()
+{
+    verb.out() << "\
+Usage: kmapbench [options] [map_type filename[.map]...]...\n\
+map_type:\n\
+    -i: IBM map files follow (default)\n\
+    -w: Watcom map files follow\n\
+options:\n\
+    -r N: Run N times per file, and report the fastest run (default: 3)\n\
+    -j N: Use N threads (default: # of CPUs)\n\
+    -g file: Check .SYM files against hashes in file. Hashes missing in\n\
+             file are added to it\n\
+";
+}
+
+/**
+ * Get the peak resident set size of the process
+ *
+ * @return Peak RSS in bytes, or 0 if unknown
+ */
+static uint64_t peakRss()
+{
+#ifdef __OS2__
+    return 0;
+#else
+    struct rusage ru;
+
+    if( getrusage( RUSAGE_SELF, &ru ) != 0 )
+        return 0;
+
+#ifdef __APPLE__
+    return ru.ru_maxrss;
+#else
+    return static_cast< uint64_t >( ru.ru_maxrss ) * 1024;
+#endif
+#endif
+}
+
+/**
+ * Convert a .MAP file once through the records kept by the parser, and
+ * measure it
+ *
+ * @param[in]  input    .MAP file
+ * @param[in]  symPath  .SYM file path
+ * @param[in]  pool     Thread pool to use
+ * @param[out] result   Result
+ * @return              true if success, otherwise false
+ */
+static bool run( const Input& input, const std::string& symPath,
+                 KThreadPool& pool, Result& result )
+{
+    auto& stats = KStats::instance();
+    auto heap = KStats::heapCounters();
+
+    stats.reset();
+
+    uint64_t allocs = 0;
+
+    if( heap )
+    {
+        allocs = heap->allocs;
+        heap->peakBytes = heap->curBytes.load();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::unique_ptr< KMapParser > parser;
+    if( input.watcom )
+        parser = std::make_unique< KWatcomMapParser >();
+    else
+        parser = std::make_unique< KIbmMapParser >();
+
+    KSymWriter writer;
+
+    parser->setThreadPool( &pool );
+    writer.setThreadPool( &pool );
+
+    if( !parser->open( input.file ) || !parser->parse())
+    {
+        verb.err() << "Cannot parse " << input.file << "!!!\n";
+
+        return false;
+    }
+
+    writer.setModuleName( parser->moduleName());
+    writer.reserve( parser->segments().size() + parser->groups().size(),
+                    parser->publicsByValue().size());
+
+    for( const auto& seg: parser->segments())
+        writer.addSegment( seg );
+
+    for( const auto& group: parser->groups())
+        writer.addGroup( group );
+
+    for( const auto& pub: parser->publicsByValue())
+        writer.addSymbol( pub );
+
+    if( !writer.open( symPath ))
+    {
+        verb.err() << "Cannot create " << symPath << "!!!\n";
+
+        return false;
+    }
+
+    writer.setEntryPoint( parser->entryPoint().empty() ?
+                          "0000:0010" : parser->entryPoint());
+
+    if( !writer.write() || !writer.close())
+    {
+        verb.err() << "Cannot write " << symPath << "!!!\n";
+
+        return false;
+    }
+
+    result.totalNs = std::chrono::duration_cast< std::chrono::nanoseconds >(
+                        std::chrono::steady_clock::now() - start ).count();
+
+    result.bytes = stats.count( KStats::Counter::BytesRead );
+    result.symbols = parser->publicsByValue().size();
+    result.parseNs = stats.time( KStats::Phase::Open )
+                     + stats.time( KStats::Phase::Parse );
+    result.sortNs = stats.time( KStats::Phase::Sort );
+    result.writeNs = stats.time( KStats::Phase::Layout )
+                     + stats.time( KStats::Phase::Write );
+
+    if( heap )
+    {
+        result.allocs = heap->allocs - allocs;
+        result.peakHeap = heap->peakBytes;
+    }
+
+    return true;
+}
+
+/**
+ * Calculate the hash of a file
+ *
+ * @param[in]  fileName File name
+ * @param[out] hash     XXH64 hash of the contents
+ * @return              true if success, otherwise false
+ */
+static bool hashFile( const std::string& fileName, uint64_t& hash )
+{
+    KMappedFile file;
+
+    if( !file.open( fileName ))
+        return false;
+
+    hash = KHash::xxh64( file.view());
+
+    return true;
+}
+
+/**
+ * Read a golden hash file
+ *
+ * @param[in]  fileName Golden hash file name
+ * @param[out] hashes   Hashes by .SYM file name
+ * @remark              A missing file is empty
+ */
+static void readGolden( const std::string& fileName,
+                        std::map< std::string, uint64_t >& hashes )
+{
+    std::ifstream ifs( fileName );
+    std::string line;
+
+    // lines of a hash in hex and a .SYM file name
+    while( std::getline( ifs, line ))
+    {
+        std::istringstream iss( line );
+        uint64_t hash;
+        std::string name;
+
+        if( iss >> std::hex >> hash >> name )
+            hashes[ name ] = hash;
+    }
+}
+
+/**
+ * Write a golden hash file
+ *
+ * @param[in] fileName  Golden hash file name
+ * @param[in] hashes    Hashes by .SYM file name
+ * @return              true if success, otherwise false
+ */
+static bool writeGolden( const std::string& fileName,
+                         const std::map< std::string, uint64_t >& hashes )
+{
+    std::ofstream ofs( fileName );
+
+    for( const auto& [ name, hash ]: hashes )
+        ofs << std::hex << std::setw( 16 ) << std::setfill('0') << hash
+            << " " << name << "\n";
+
+    return static_cast< bool >( ofs.flush());
+}
+
+/**
+ * Print a row of the result table
+ */
+static void printRow( const std::string& name, const Result& r )
+{
+    auto ms = []( uint64_t ns ) { return ns / 1e6; };
+    double mb = r.bytes / 1e6;
+    double sec = r.totalNs / 1e9;
+
+    verb.out() << std::left << std::setw( 24 ) << name << std::right
+               << std::fixed << std::setprecision( 1 )
+               << std::setw( 8 ) << mb
+               << std::setw( 10 ) << r.symbols
+               << std::setw( 9 ) << ms( r.parseNs )
+               << std::setw( 9 ) << ms( r.sortNs )
+               << std::setw( 9 ) << ms( r.writeNs )
+               << std::setw( 9 ) << ms( r.totalNs )
+               << std::setw( 8 ) << ( sec > 0 ? mb / sec : 0 )
+               << std::setw( 8 ) << ( sec > 0 ? r.symbols / sec / 1e6 : 0 );
+
+    if( KStats::heapCounted())
+        verb.out() << std::setw( 10 ) << r.allocs
+                   << std::setw( 9 ) << r.peakHeap / 1e6;
+
+    verb.out() << "\n";
+}
+
+int main( int argc, char *argv[])
+{
+    Options opts;
+    bool watcom = false;
+
+    std::ios::sync_with_stdio( false );
+
+    for( int i = 1; i < argc; i++ )
+    {
+        std::string arg( argv[ i ]);
+
+        if( arg.compare("-i") == 0 )
+            watcom = false;
+        else if( arg.compare("-w") == 0 )
+            watcom = true;
+        else if( arg.compare("-r") == 0 || arg.compare("-j") == 0 )
+        {
+            char *end = nullptr;
+            size_t n = i + 1 < argc ? std::strtoul( argv[ ++i ], &end, 10 )
+                                    : 0;
+
+            if( !end || *end != '\0' || n == 0 )
+            {
+                verb.err() << "Invalid argument of " << arg << "!!!\n";
+                showUsage();
+
+                return 1;
+            }
+
+            ( arg[ 1 ] == 'r' ? opts.repeat : opts.jobs ) = n;
+        }
+        else if( arg.compare("-g") == 0 && i + 1 < argc )
+            opts.golden = argv[ ++i ];
+        else if( arg[ 0 ] == '-')
+        {
+            verb.err() << "Invalid argument: " << arg << "!!!\n";
+            showUsage();
+
+            return 1;
+        }
+        else
+            opts.inputs.push_back({ arg, watcom });
+    }
+
+    if( opts.inputs.empty())
+    {
+        verb.err() << "Missing .MAP file name!!!\n";
+        showUsage();
+
+        return 1;
+    }
+
+    std::map< std::string, uint64_t > golden;
+    bool goldenChanged = false;
+
+    if( !opts.golden.empty())
+        readGolden( opts.golden, golden );
+
+    KThreadPool pool( opts.jobs );
+    int rc = 0;
+
+    verb.out() << "map                           MB   symbols    parse"
+                  "     sort    write    total    MB/s  Msym/s";
+    if( KStats::heapCounted())
+        verb.out() << "    allocs  heap MB";
+    verb.out() << "\n";
+
+    for( auto input: opts.inputs )
+    {
+        std::filesystem::path mapPath( input.file );
+
+        if( mapPath.extension().empty())
+            mapPath += ".map";
+
+        input.file = mapPath.string();
+
+        auto symPath = mapPath;
+        symPath.replace_extension(".sym");
+
+        Result best;
+        bool ok = true;
+
+        // discard the messages of the runs after the first one
+        std::ostringstream discarded;
+
+        for( size_t n = 0; ok && n < opts.repeat; n++ )
+        {
+            Result result;
+
+            if( n > 0 )
+                verb.redirect( &discarded, &discarded );
+
+            ok = run( input, symPath.string(), pool, result );
+
+            verb.redirect( nullptr, nullptr );
+
+            if( ok && ( n == 0 || result.totalNs < best.totalNs ))
+                best = result;
+        }
+
+        if( !ok )
+        {
+            rc = 1;
+
+            continue;
+        }
+
+        auto name = mapPath.filename().string();
+
+        printRow( name, best );
+
+        if( opts.golden.empty())
+            continue;
+
+        uint64_t hash;
+        auto symName = symPath.filename().string();
+
+        if( !hashFile( symPath.string(), hash ))
+        {
+            verb.err() << "Cannot read " << symPath.string() << "!!!\n";
+
+            rc = 1;
+        }
+        else if( golden.count( symName ) == 0 )
+        {
+            verb.out() << "    golden hash of " << symName << " added\n";
+
+            golden[ symName ] = hash;
+            goldenChanged = true;
+        }
+        else if( golden[ symName ] != hash )
+        {
+            verb.err() << symName << " differs from the golden output!!!\n";
+
+            rc = 1;
+        }
+    }
+
+    uint64_t rss = peakRss();
+
+    verb.out() << "peak RSS: ";
+    if( rss )
+        verb.out() << std::fixed << std::setprecision( 1 ) << rss / 1e6
+                   << " MB\n";
+    else
+        verb.out() << "unknown\n";
+
+    if( !opts.golden.empty())
+    {
+        if( goldenChanged && !writeGolden( opts.golden, golden ))
+        {
+            verb.err() << "Cannot write " << opts.golden << "!!!\n";
+
+            rc = 1;
+        }
+        else if( rc == 0 && !goldenChanged )
+            verb.out() << "All .SYM files match " << opts.golden << "\n";
+    }
+
+    return rc;
+}
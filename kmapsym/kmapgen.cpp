@@ -0,0 +1,818 @@
+/*
+ * KMapGen
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file
+ *
+ * Generate synthetic .MAP files to benchmark kmapsym. The same options
+ * always generate the same file.
+ */
+
+#include "kcollation.h"
+#include "kverbose.h"
+
+#include <fstream>
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+
+#define verb KVerbose::instance()
+
+/**
+ * .MAP file type
+ */
+enum class MapType
+{
+    Ibm,    ///< IBM map file genereated by link386 and ilink
+    Watcom  ///< Watcom map file generated by wlink
+};
+
+/**
+ * Segment layout
+ */
+enum class Layout
+{
+    Bits16,     ///< 16-bit segments only
+    Bits32,     ///< 32-bit segments only
+    Mixed       ///< 32-bit odd segments, and 16-bit even segments
+};
+
+/**
+ * Options
+ */
+struct Options
+{
+    MapType type = MapType::Ibm;    ///< .MAP file type
+    Layout layout = Layout::Bits32; ///< segment layout
+    uint64_t segments = 4;          ///< # of segments
+    uint64_t groups = 1;            ///< # of groups
+    uint64_t publics = 10000;       ///< # of public symbols
+    uint64_t imports = 10;          ///< # of imported symbols
+    uint64_t seed = 1;              ///< seed of random numbers
+    std::string file;               ///< .MAP file to generate
+};
+
+/**
+ * Pseudo random number generator, SplitMix64
+ *
+ * Unlike the distributions of \<random\>, the numbers are the same
+ * everywhere.
+ */
+class Random
+{
+public:
+    /**
+     * Constructor
+     *
+     * @param[in] seed  Seed
+     */
+    explicit Random( uint64_t seed ) : _state( seed ) {}
+
+    /**
+     * Get the next number
+     */
+    uint64_t next()
+    {
+        uint64_t z = ( _state += 0x9E3779B97F4A7C15ULL );
+
+        z = ( z ^ ( z >> 30 )) * 0xBF58476D1CE4E5B9ULL;
+        z = ( z ^ ( z >> 27 )) * 0x94D049BB133111EBULL;
+
+        return z ^ ( z >> 31 );
+    }
+
+    /**
+     * Get the next number less than @p n
+     */
+    uint32_t below( uint32_t n ) { return n ? next() % n : 0; }
+
+private:
+    uint64_t _state;    ///< state
+};
+
+/**
+ * Segment
+ */
+struct Segment
+{
+    uint32_t num;           ///< segment number
+    std::string name;       ///< segment name
+    std::string className;  ///< class name
+    std::string groupName;  ///< name of group starting at the segment
+    int nBits;              ///< # of bits
+    uint32_t length;        ///< length
+};
+
+/**
+ * Public symbol
+ */
+struct Public
+{
+    uint32_t segNum;    ///< segment number. 0 for a constant
+    uint32_t ofs;       ///< offset, or value of a constant
+    uint32_t nameOfs;   ///< offset of the name in the name arena
+    uint32_t nameLen;   ///< length of the name
+};
+
+/**
+ * Buffered output of a .MAP file
+ */
+class Output
+{
+public:
+    /**
+     * Open a file
+     *
+     * @param[in] fileName  File name
+     * @return              true if success, otherwise false
+     */
+    bool open( const std::string& fileName )
+    {
+        _ofs.open( fileName, std::ios::binary );
+
+        return static_cast< bool >( _ofs );
+    }
+
+    /**
+     * Flush the buffer, and close the file
+     *
+     * @return true if success, otherwise false
+     */
+    bool close()
+    {
+        flush();
+        _ofs.close();
+
+        return static_cast< bool >( _ofs );
+    }
+
+    /**
+     * Put a string
+     */
+    Output& operator<<( std::string_view s )
+    {
+        _buf.append( s );
+
+        if( _buf.size() >= BufSize )
+            flush();
+
+        return *this;
+    }
+
+    /**
+     * Put a string padded with spaces to @p width
+     */
+    Output& pad( std::string_view s, size_t width )
+    {
+        *this << s;
+
+        if( s.size() < width )
+            _buf.append( width - s.size(), ' ');
+
+        return *this;
+    }
+
+    /**
+     * Put a number in hex of @p width digits at least
+     */
+    Output& hex( uint32_t n, int width )
+    {
+        char digits[ 8 ];
+        int len = 0;
+
+        do
+        {
+            digits[ len++ ] = "0123456789ABCDEF"[ n & 0xF ];
+            n >>= 4;
+        } while( n );
+
+        for( ; width > len; width-- )
+            _buf.push_back('0');
+
+        while( len > 0 )
+            _buf.push_back( digits[ --len ]);
+
+        return *this;
+    }
+
+    /**
+     * Put a number in decimal
+     */
+    Output& dec( uint64_t n ) { return *this << std::to_string( n ); }
+
+    /**
+     * Put an address in ssss:oooo or ssss:oooooooo form
+     */
+    Output& addr( uint32_t segNum, uint32_t ofs, int nBits )
+    {
+        hex( segNum, 4 );
+        _buf.push_back(':');
+
+        return hex( ofs, nBits == 16 ? 4 : 8 );
+    }
+
+    /**
+     * End a line
+     */
+    Output& eol() { return *this << "\r\n"; }
+
+private:
+    static constexpr size_t BufSize = 1024 * 1024;  ///< size of the buffer
+
+    std::ofstream _ofs;     ///< file
+    std::string _buf;       ///< buffer
+
+    /**
+     * Write the buffer to the file
+     */
+    void flush()
+    {
+        _ofs.write( _buf.data(), _buf.size());
+        _buf.clear();
+    }
+};
+
+/**
+ * Synthetic .MAP file
+ */
+struct Map
+{
+    std::vector< Segment > segments;    ///< segments
+    std::string names;                  ///< name arena of public symbols
+    std::vector< Public > publics;      ///< public symbols
+    std::vector< uint32_t > byName;     ///< indexes sorted by name
+    std::vector< uint32_t > byValue;    ///< indexes sorted by value
+
+    /**
+     * Get the name of a public symbol
+     */
+    std::string_view nameOf( uint32_t i ) const
+    {
+        return std::string_view( names ).substr( publics[ i ].nameOfs,
+                                                 publics[ i ].nameLen );
+    }
+
+    /**
+     * Get the # of bits of a segment
+     */
+    int bitsOf( uint32_t segNum ) const
+    {
+        // constants are printed as 32-bit
+        return segNum == 0 ? 32 : segments[ segNum - 1 ].nBits;
+    }
+};
+
+/**
+ * Parse a count with an optional suffix k or M
+ *
+ * @param[in]  s    String to parse
+ * @param[out] n    Count
+ * @return          true if success, otherwise false
+ */
+static bool parseCount( const std::string& s, uint64_t& n )
+{
+    char *end;
+
+    n = std::strtoull( s.c_str(), &end, 10 );
+
+    if( end == s.c_str())
+        return false;
+
+    if( *end == 'k')
+    {
+        n *= 1000;
+        end++;
+    }
+    else if( *end == 'M')
+    {
+        n *= 1000 * 1000;
+        end++;
+    }
+
+    return *end == '\0';
+}
+
+/**
+ * Append a symbol name
+ *
+ * @param[in]     rnd   Random number generator
+ * @param[in]     i     Index making the name unique
+ * @param[in,out] names Name arena to append to
+ */
+static void makeName( Random& rnd, uint64_t i, std::string& names )
+{
+    static const char *const prefixes[] = {
+        "", "", "", "_", "__", "Dos", "Win", "Gpi", "K", "my", "str", "mem"
+    };
+
+    static const char *const words[] = {
+        "alloc", "free", "open", "close", "read", "write", "buf", "list",
+        "node", "map", "sym", "seg", "init", "term", "get", "set", "Item",
+        "Data", "Proc", "Wnd", "Hash", "Table", "Query", "Font"
+    };
+
+    auto start = names.size();
+
+    names += prefixes[ rnd.below( std::size( prefixes ))];
+
+    for( auto n = 1 + rnd.below( 3 ); n > 0; n-- )
+        names += words[ rnd.below( std::size( words ))];
+
+    // vary the case of some names
+    switch( rnd.below( 8 ))
+    {
+        case 0:
+            for( auto it = names.begin() + start; it != names.end(); ++it )
+                *it = std::toupper( static_cast< unsigned char >( *it ));
+            break;
+
+        case 1:
+            for( auto it = names.begin() + start; it != names.end(); ++it )
+                *it = std::tolower( static_cast< unsigned char >( *it ));
+            break;
+    }
+
+    // unique suffix in base 36
+    char digits[ 16 ];
+    int len = 0;
+
+    do
+    {
+        digits[ len++ ] = "0123456789abcdefghijklmnopqrstuvwxyz"[ i % 36 ];
+        i /= 36;
+    } while( i );
+
+    names += '_';
+    while( len > 0 )
+        names += digits[ --len ];
+}
+
+/**
+ * Generate segments and public symbols
+ *
+ * @param[in]  opts Options
+ * @param[out] map  Generated map
+ */
+static void generate( const Options& opts, Map& map )
+{
+    static const char *const classes[] = { "CODE", "DATA", "CONST", "BSS" };
+
+    Random rnd( opts.seed );
+
+    uint64_t perSeg = opts.publics / opts.segments + 1;
+
+    for( uint32_t num = 1; num <= opts.segments; num++ )
+    {
+        int nBits = opts.layout == Layout::Bits16 ? 16 :
+                    opts.layout == Layout::Bits32 ? 32 :
+                    num % 2 ? 32 : 16;
+        std::string className( classes[( num - 1 ) % std::size( classes )]);
+
+        uint32_t length =
+            nBits == 16 ? 0xFFF0 :
+            static_cast< uint32_t >( std::min< uint64_t >(
+                std::max< uint64_t >( perSeg * 32, 0x1000 ), 0x7FFFFFF0 ));
+
+        map.segments.push_back({ num,
+                                 className + std::to_string( nBits ) + "_"
+                                    + std::to_string( num ),
+                                 className, {}, nBits, length });
+    }
+
+    for( uint64_t i = 0; i < opts.groups; i++ )
+    {
+        auto& seg = map.segments[( i + 1 ) % opts.segments ];
+
+        // one group per segment at most
+        if( !seg.groupName.empty())
+            break;
+
+        seg.groupName = i == 0 ? "DGROUP" :
+                        i == 1 ? "FLAT" : "GROUP" + std::to_string( i );
+    }
+
+    map.publics.reserve( opts.publics );
+
+    for( uint64_t i = 0; i < opts.publics; i++ )
+    {
+        Public pub;
+
+        // a few constants in IBM maps
+        if( opts.type == MapType::Ibm && rnd.below( 64 ) == 0 )
+        {
+            pub.segNum = 0;
+            pub.ofs = rnd.below( 0x100000 );
+        }
+        else
+        {
+            pub.segNum = 1 + rnd.below( opts.segments );
+            pub.ofs = rnd.below( map.segments[ pub.segNum - 1 ].length );
+        }
+
+        pub.nameOfs = map.names.size();
+        makeName( rnd, i, map.names );
+        pub.nameLen = map.names.size() - pub.nameOfs;
+
+        map.publics.push_back( pub );
+    }
+
+    map.byName.resize( map.publics.size());
+    for( uint32_t i = 0; i < map.byName.size(); i++ )
+        map.byName[ i ] = i;
+
+    // IBM maps sort publics by name case-insensitively
+    KCollation coll( KCollation::Fold::Upper );
+
+    coll.sort( map.byName, [ & ]( uint32_t i ) { return map.nameOf( i ); });
+
+    // by value, and then by name
+    std::vector< std::pair< uint64_t, uint32_t >> keys;
+
+    keys.reserve( map.byName.size());
+    for( uint32_t i = 0; i < map.byName.size(); i++ )
+    {
+        const auto& pub = map.publics[ map.byName[ i ]];
+
+        keys.emplace_back( static_cast< uint64_t >( pub.segNum ) << 32
+                               | pub.ofs, i );
+    }
+
+    std::sort( keys.begin(), keys.end());
+
+    map.byValue.reserve( keys.size());
+    for( const auto& key: keys )
+        map.byValue.push_back( map.byName[ key.second ]);
+}
+
+/**
+ * Get the DLL name of an imported symbol
+ */
+static const char *importDll( uint64_t i )
+{
+    static const char *const dlls[] = {
+        "DOSCALLS", "PMWIN", "PMGPI", "LIBC066"
+    };
+
+    return dlls[ i % std::size( dlls )];
+}
+
+/**
+ * Write a public symbol line of an IBM map
+ */
+static void writeIbmPublic( Output& out, const Map& map, uint32_t i )
+{
+    const auto& pub = map.publics[ i ];
+
+    out << " ";
+    out.addr( pub.segNum, pub.ofs, map.bitsOf( pub.segNum ));
+    out << ( pub.segNum == 0 ? "  Abs  " : "       ") << map.nameOf( i );
+    out.eol();
+}
+
+/**
+ * Write an IBM map
+ *
+ * @param[in] out   Output
+ * @param[in] opts  Options
+ * @param[in] map   Generated map
+ */
+static void writeIbm( Output& out, const Options& opts, const Map& map )
+{
+    out.eol() << " BENCH";
+    out.eol().eol() << " Start         Length     Name                   Class";
+    out.eol();
+
+    for( const auto& seg: map.segments )
+    {
+        out << " ";
+        out.addr( seg.num, 0, seg.nBits ) << " ";
+        out.hex( seg.length, 9 ) << "H ";
+        out.pad( seg.name, 22 ) << " ";
+        out << seg.className << " " << std::to_string( seg.nBits ) << "-bit";
+        out.eol();
+    }
+
+    out.eol() << " Origin   Group";
+    out.eol();
+
+    for( const auto& seg: map.segments )
+    {
+        if( seg.groupName.empty())
+            continue;
+
+        out << " ";
+        out.hex( seg.num, 4 ) << ":0   " << seg.groupName;
+        out.eol();
+    }
+
+    out.eol() << "  Address         Publics by Name";
+    out.eol().eol();
+
+    // merge imported symbols into publics by name. they are not sorted
+    // with publics, but spread evenly
+    uint64_t step = opts.imports ? map.byName.size() / opts.imports + 1 : 0;
+    uint64_t imp = 0;
+
+    for( uint64_t i = 0; i < map.byName.size() || imp < opts.imports; i++ )
+    {
+        if( imp < opts.imports && ( i >= map.byName.size() || i % step == 0 ))
+        {
+            out << " ";
+            out.addr( 1, imp * 4, map.segments[ 0 ].nBits );
+            out << "  Imp  ";
+            out.pad( "Imp" + std::to_string( imp ), 20 );
+            out << " (" << importDll( imp ) << ".";
+            out.dec( imp + 1 ) << ")";
+            out.eol();
+
+            imp++;
+        }
+
+        if( i < map.byName.size())
+            writeIbmPublic( out, map, map.byName[ i ]);
+    }
+
+    out.eol() << "  Address         Publics by Value";
+    out.eol().eol();
+
+    for( auto i: map.byValue )
+        writeIbmPublic( out, map, i );
+
+    out.eol() << "Program entry point at ";
+    out.addr( 1, 0x10, map.segments[ 0 ].nBits );
+    out.eol();
+}
+
+/**
+ * Write a box title of a Watcom map
+ */
+static void writeWatcomTitle( Output& out, std::string_view title )
+{
+    std::string line( title.size() + 8, '-');
+
+    line.front() = line.back() = '+';
+
+    out << "                        " << line;
+    out.eol() << "                        |   " << title << "   |";
+    out.eol() << "                        " << line;
+    out.eol().eol();
+}
+
+/**
+ * Write a Watcom map
+ *
+ * @param[in] out   Output
+ * @param[in] opts  Options
+ * @param[in] map   Generated map
+ */
+static void writeWatcom( Output& out, const Options& opts, const Map& map )
+{
+    static const char flags[] = { ' ', ' ', '*', '+' };
+
+    Random rnd( opts.seed );
+
+    out << "Open Watcom Linker Version 2.0 beta";
+    out.eol() << "Executable Image: bench.exe";
+    out.eol() << "creating an OS/2 32-bit executable";
+    out.eol().eol();
+
+    writeWatcomTitle( out, "Groups");
+
+    out << "Group                           Address              Size";
+    out.eol() << "=====                           =======              ====";
+    out.eol().eol();
+
+    for( const auto& seg: map.segments )
+    {
+        if( seg.groupName.empty())
+            continue;
+
+        out.pad( seg.groupName, 32 );
+        out.addr( seg.num, 0, seg.nBits ) << "        ";
+        out.hex( seg.length, 8 );
+        out.eol();
+    }
+
+    out.eol();
+
+    writeWatcomTitle( out, "Segments");
+
+    out << "Segment                Class          Group          Address"
+           "         Size";
+    out.eol() << "=======                =====          =====          ======="
+                 "         ====";
+    out.eol().eol();
+
+    for( const auto& seg: map.segments )
+    {
+        out.pad( seg.name, 23 );
+        out.pad( seg.className, 15 );
+        out.pad( seg.groupName.empty() ? "AUTO" : seg.groupName, 15 );
+        out.addr( seg.num, 0, seg.nBits ) << ( seg.nBits == 16 ? "       "
+                                                               : "   ");
+        out.hex( seg.length, seg.nBits == 16 ? 4 : 8 );
+        out.eol();
+    }
+
+    out.eol();
+
+    writeWatcomTitle( out, "Memory Map");
+
+    out << "* = unreferenced symbol";
+    out.eol() << "+ = symbol only referenced locally";
+    out.eol().eol() << "Address        Symbol";
+    out.eol() << "=======        ======";
+    out.eol().eol();
+
+    // modules of 50 symbols in order of address
+    for( uint64_t i = 0; i < map.byValue.size(); i++ )
+    {
+        if( i % 50 == 0 )
+        {
+            auto num = std::to_string( i / 50 );
+
+            out << "Module: m" << num << ".obj(m" << num << ".c)";
+            out.eol();
+        }
+
+        const auto& pub = map.publics[ map.byValue[ i ]];
+        char flag[] = { flags[ rnd.below( std::size( flags ))], ' ', '\0' };
+
+        out.addr( pub.segNum, pub.ofs, map.bitsOf( pub.segNum )) << flag
+            << map.nameOf( map.byValue[ i ]);
+        out.eol();
+    }
+
+    out.eol();
+
+    writeWatcomTitle( out, "Imported Symbols");
+
+    out << "Symbol                              Module";
+    out.eol() << "======                              ======";
+    out.eol().eol();
+
+    for( uint64_t i = 0; i < opts.imports; i++ )
+    {
+        out.pad( "Imp" + std::to_string( i ), 36 ) << importDll( i );
+        out.eol();
+    }
+
+    out.eol();
+
+    writeWatcomTitle( out, "Libraries Used");
+
+    out << "bench.lib";
+    out.eol().eol();
+
+    writeWatcomTitle( out, "Linker Statistics");
+
+    out << "Stack size:  00010000 (65536.)";
+    out.eol() << "Entry point address: ";
+    out.addr( 1, 0x10, map.segments[ 0 ].nBits );
+    out.eol();
+}
+
+/**
+ * Show usage
+ */
+static void showUsage()
+{
+    verb.out() << "\
+Usage: kmapgen map_type [options] filename.map\n\
+map_type:\n\
+    -i: IBM map file (default)\n\
+    -w: Watcom map file\n\
+options:\n\
+    -b 16|32|mixed: Segment layout (default: 32)\n\
+    -s N: Number of segments (default: 4)\n\
+    -g N: Number of groups (default: 1)\n\
+    -p N: Number of public symbols (default: 10k)\n\
+    -m N: Number of imported symbols (default: 10)\n\
+    -S N: Seed of random numbers (default: 1)\n\
+    N may end with k for thousands, or M for millions\n\
+";
+}
+
+int main( int argc, char *argv[])
+{
+    Options opts;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        std::string arg( argv[ i ]);
+
+        if( arg.compare("-i") == 0 )
+            opts.type = MapType::Ibm;
+        else if( arg.compare("-w") == 0 )
+            opts.type = MapType::Watcom;
+        else if( arg.size() == 2 && arg[ 0 ] == '-'
+                 && std::string_view("bsgpmS").find( arg[ 1 ])
+                        != std::string_view::npos )
+        {
+            if( i + 1 >= argc )
+            {
+                verb.err() << "Missing argument of " << arg << "!!!\n";
+                showUsage();
+
+                return 1;
+            }
+
+            std::string val( argv[ ++i ]);
+            uint64_t n = 0;
+            bool ok = true;
+
+            if( arg[ 1 ] == 'b')
+            {
+                if( val.compare("16") == 0 )
+                    opts.layout = Layout::Bits16;
+                else if( val.compare("32") == 0 )
+                    opts.layout = Layout::Bits32;
+                else if( val.compare("mixed") == 0 )
+                    opts.layout = Layout::Mixed;
+                else
+                    ok = false;
+            }
+            else
+                ok = parseCount( val, n );
+
+            switch( arg[ 1 ])
+            {
+                case 's': opts.segments = n; ok = ok && n > 0; break;
+                case 'g': opts.groups = n; break;
+                case 'p': opts.publics = n; ok = ok && n < 0xFFFFFFFF; break;
+                case 'm': opts.imports = n; break;
+                case 'S': opts.seed = n; break;
+            }
+
+            if( !ok || opts.segments > 0xFFFF )
+            {
+                verb.err() << "Invalid argument of " << arg << ": " << val
+                           << "!!!\n";
+                showUsage();
+
+                return 1;
+            }
+        }
+        else if( arg[ 0 ] == '-' || !opts.file.empty())
+        {
+            verb.err() << "Invalid argument: " << arg << "!!!\n";
+            showUsage();
+
+            return 1;
+        }
+        else
+            opts.file = arg;
+    }
+
+    if( opts.file.empty())
+    {
+        verb.err() << "Missing .MAP file name!!!\n";
+        showUsage();
+
+        return 1;
+    }
+
+    Map map;
+
+    generate( opts, map );
+
+    Output out;
+
+    if( !out.open( opts.file ))
+    {
+        verb.err() << "Cannot create " << opts.file << "!!!\n";
+
+        return 1;
+    }
+
+    if( opts.type == MapType::Ibm )
+        writeIbm( out, opts, map );
+    else
+        writeWatcom( out, opts, map );
+
+    if( !out.close())
+    {
+        verb.err() << "Cannot write " << opts.file << "!!!\n";
+
+        return 1;
+    }
+
+    return 0;
+}
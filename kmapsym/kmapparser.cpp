@@ -15,14 +15,46 @@
 /** @file */
 
 #include "kmapparser.h"
+#include "kcollation.h"
+#include "kverbose.h"
 
 #include <algorithm>
+#include <charconv>
+#include <utility>
 
-#include <cctype>
+#include <cstring>
+
+#define verb KVerbose::instance()
+
+bool KMapParser::parseHex( std::string_view sv, uint32_t& val )
+{
+    auto end = sv.data() + sv.size();
+    auto res = std::from_chars( sv.data(), end, val, 16 );
+
+    return res.ec == std::errc() && res.ptr == end;
+}
+
+bool KMapParser::parseAddr( std::string_view sv, Addr& addr )
+{
+    auto colon = sv.find(':');
+    if( colon == std::string_view::npos )
+        return false;
+
+    uint32_t seg, ofs;
+
+    if( !parseHex( sv.substr( 0, colon ), seg )
+        || !parseHex( sv.substr( colon + 1 ), ofs ))
+        return false;
+
+    addr = makeAddr( seg, ofs );
+
+    return true;
+}
 
 KMapParser::KMapParser( std::string_view fileName )
     : _fileName( fileName )
-    , _state( State::None )
+    , _pool( nullptr )
+    , _sections( SecAll )
 {
 }
 
@@ -33,84 +65,53 @@ KMapParser::~KMapParser()
 
 bool KMapParser::open( std::string_view fileName )
 {
+    KStats::Timer timer( KStats::Phase::Open );
+
     if( !fileName.empty())
         _fileName = fileName;
 
     if( _fileName.empty())
         return false;
 
-    _ifs.open( std::string( _fileName ), std::ios::in );
-    if( !_ifs )
+    if( !_file.open( _fileName ))
         return false;
 
+    // forget the previous .MAP file to reuse a parser
+    _moduleName.clear();
+    _segments.clear();
+    _groups.clear();
+    _publics.clear();
+    _publicsByName.clear();
+    _publicsByValue.clear();
+    _imports.clear();
+    _entryPoint.clear();
+    _lines.clear();
+
     return true;
 }
 
 bool KMapParser::close()
 {
-    _ifs.close();
-    _ifs.clear();
+    _file.close();
 
     return true;
 }
 
 bool KMapParser::parse()
 {
-    std::string line;
-
-    state( State::None );
-
-    while( std::getline( _ifs, line ))
-    {
-#ifndef __EMX__
-        if( line.back() == '\r')
-          line.pop_back();
-#endif
-
-        if( !parseLine( line ))
-            return false;
-    }
+    if( !parseRecords())
+        return false;
 
     if(( _publicsByName.empty() && _publicsByValue.empty())
        || ( !_publicsByName.empty() && !_publicsByValue.empty()))
         return true;
 
-    // compare strings case-insensitively by converting to uppercase
-    auto nameCmp = []( const Public& a, const Public& b )
-    {
-        std::string ua;
-        std::string ub;
-
-        ua.resize( a.name.size());
-        ub.resize( b.name.size());
-
-        std::transform( a.name.begin(), a.name.end(), ua.begin(),
-                        ::toupper );
-        std::transform( b.name.begin(), b.name.end(), ub.begin(),
-                        ::toupper );
-
-        auto cmp = ua.compare( ub );
-        return cmp < 0 || ( cmp == 0 && a.name.compare( b.name ) < 0 );
-    };
-
     if( _publicsByValue.empty())
     {
         // only _publicsByName was populated
 
         // watcom map, whose publics are not sorted by name neither by value
-
-        // sort by name
-        std::sort( _publicsByName.begin(), _publicsByName.end(), nameCmp );
-
-        _publicsByValue = _publicsByName;
-
-        // sort by value
-        std::sort( _publicsByValue.begin(), _publicsByValue.end(),
-                   [ &nameCmp ]( const Public& a, const Public& b )
-        {
-            auto cmp = a.addr.compare( b.addr );
-            return cmp < 0 || ( cmp == 0 && nameCmp( a, b ));
-        });
+        sortPublics( _publics, _publicsByName, _publicsByValue );
     }
 
     if( _publicsByName.empty())
@@ -121,13 +122,125 @@ bool KMapParser::parse()
 
         _publicsByName = _publicsByValue;
 
+        // compare strings case-insensitively by converting to uppercase
+        KCollation coll( KCollation::Fold::Upper );
+
         // sort by name
-        std::sort( _publicsByName.begin(), _publicsByName.end(), nameCmp );
+        coll.sort( _publicsByName,
+                   [ this ]( uint32_t i ) { return _publics[ i ].name; });
     }
 
     return true;
 }
 
+void KMapParser::sortPublics( const std::vector< Public >& publics,
+                              std::vector< uint32_t >& byName,
+                              std::vector< uint32_t >& byValue )
+{
+    KStats::Timer timer( KStats::Phase::Sort );
+
+    // compare strings case-insensitively by converting to uppercase
+    KCollation coll( KCollation::Fold::Upper );
+
+    // sort by name
+    coll.sort( byName, [ & ]( uint32_t i ) { return publics[ i ].name; });
+
+    // sort by value, and then by the position in the list sorted by name
+    std::vector< std::pair< Addr, uint32_t >> keys;
+
+    keys.reserve( byName.size());
+    for( uint32_t i = 0; i < byName.size(); i++ )
+        keys.emplace_back( publics[ byName[ i ]].addr, i );
+
+    std::sort( keys.begin(), keys.end());
+
+    byValue.clear();
+    byValue.reserve( keys.size());
+    for( const auto& key: keys )
+        byValue.push_back( byName[ key.second ]);
+}
+
+std::string_view KMapParser::nextLine( std::string_view& buf )
+{
+    auto eol = static_cast< const char * >(
+                    std::memchr( buf.data(), '\n', buf.size()));
+    size_t len = eol ? eol - buf.data() : buf.size();
+
+    auto line = buf.substr( 0, len );
+    buf.remove_prefix( eol ? len + 1 : len );
+
+    if( !line.empty() && line.back() == '\r')
+        line.remove_suffix( 1 );
+
+    return line;
+}
+
+void KMapParser::addStats( size_t bytes, size_t skipped,
+                           const size_t ( &lines )[ StateCount ])
+{
+    auto& stats = KStats::instance();
+
+    if( !stats.enabled())
+        return;
+
+    auto linesOf = [ & ]( State st )
+    {
+        return lines[ static_cast< size_t >( st )];
+    };
+
+    stats.add( KStats::Counter::Files, 1 );
+    stats.add( KStats::Counter::BytesRead, bytes );
+    stats.add( KStats::Counter::BytesSkipped, skipped );
+    stats.add( KStats::Counter::LinesOther, linesOf( State::None ));
+    stats.add( KStats::Counter::LinesSegments, linesOf( State::Segments ));
+    stats.add( KStats::Counter::LinesGroups, linesOf( State::Groups ));
+    stats.add( KStats::Counter::LinesPublicsByName,
+               linesOf( State::PublicsByName ));
+    stats.add( KStats::Counter::LinesPublicsByValue,
+               linesOf( State::PublicsByValue ));
+    stats.add( KStats::Counter::LinesImports, linesOf( State::Imports ));
+    stats.add( KStats::Counter::LinesLineNumbers,
+               linesOf( State::LineNumbers ));
+}
+
+bool KMapParser::unexpectedLine( std::string_view line )
+{
+    verb.err() << "Unexpected line: [" << line << "]\n";
+
+    return false;
+}
+
+std::vector< std::string_view >
+KMapParser::splitChunks( std::string_view body ) const
+{
+    size_t nChunks = std::min( _pool->size() * 4, body.size() / MinChunkSize );
+    if( nChunks == 0 )
+        nChunks = 1;
+
+    std::vector< std::string_view > texts;
+    size_t start = 0;
+
+    for( size_t i = 1; i <= nChunks && start < body.size(); i++ )
+    {
+        size_t end = body.size();
+
+        if( i < nChunks )
+        {
+            end = std::max( start, body.size() * i / nChunks );
+
+            auto eol = static_cast< const char * >(
+                            std::memchr( body.data() + end, '\n',
+                                         body.size() - end ));
+            end = eol ? eol - body.data() + 1 : body.size();
+        }
+
+        texts.push_back( body.substr( start, end - start ));
+        start = end;
+    }
+
+    return texts;
+}
+
 void KMapParser::moduleCb( std::string_view module )
 {
     _moduleName = module;
@@ -148,11 +261,13 @@ void KMapParser::publicCb( const Public& pub, State st )
     switch( st )
     {
         case State::PublicsByName:
-            _publicsByName.push_back( pub );
+            _publicsByName.push_back( _publics.size());
+            _publics.push_back( pub );
             break;
 
         case State::PublicsByValue:
-            _publicsByValue.push_back( pub );
+            _publicsByValue.push_back( _publics.size());
+            _publics.push_back( pub );
             break;
 
         default:
@@ -170,3 +285,15 @@ void KMapParser::entryCb( const std::string_view entry )
 {
     _entryPoint = entry;
 }
+
+void KMapParser::lineFileCb( std::string_view name )
+{
+    if( _lineNumbers )
+        _lines.addFile( name );
+}
+
+void KMapParser::lineNumberCb( uint32_t line, Addr addr )
+{
+    if( _lineNumbers )
+        _lines.addLine( line, addrSeg( addr ), addrOfs( addr ));
+}
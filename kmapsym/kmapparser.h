@@ -17,29 +17,48 @@
 #ifndef KMAPSYM_KMAPPARSER_H
 #define KMAPSYM_KMAPPARSER_H
 
-#include <fstream>
+#include "kmappedfile.h"
+#include "ktokenizer.h"
+#include "klinetable.h"
+#include "kthreadpool.h"
+#include "kstats.h"
 
 #include <string>
 #include <string_view>
 #include <vector>
+#include <iterator>
+
+#include <cstddef>
+#include <cstdint>
 
 /**
  * .MAP file parser base class
+ *
+ * The whole .MAP file is mapped into memory, and the records refer to it
+ * directly. So they are valid until close() is called.
  */
 class KMapParser
 {
 public:
+    /**
+     * Packed address. Segment number in the upper 32 bits, and offset in
+     * the lower 32 bits. So the addresses are ordered by segment:offset.
+     */
+    using Addr = uint64_t;
+
+    static constexpr Addr NoAddr = ~Addr( 0 );  ///< no address
+
     /**
      * Segment structure
      */
     struct Segment
     {
-        std::string addr;       ///< address of the segment
-        std::string length;     ///< length of the segment
-        std::string name;       ///< name of the segment
-        std::string className;  ///< class name of the segment
-        int nBits;              ///< # of bits of the segment.
-                                ///< 0: unknown, n: n-bits
+        Addr addr;                  ///< address of the segment
+        uint32_t length;            ///< length of the segment
+        std::string_view name;      ///< name of the segment
+        std::string_view className; ///< class name of the segment
+        int nBits;                  ///< # of bits of the segment.
+                                    ///< 0: unknown, n: n-bits
     };
 
     /**
@@ -47,9 +66,9 @@ public:
      */
     struct Group
     {
-        std::string addr;       ///< address of the group
-        std::string length;     ///< length of the group, maybe empty
-        std::string name;       ///< name of the group
+        Addr addr;                  ///< address of the group
+        uint32_t length;            ///< length of the group, maybe 0
+        std::string_view name;      ///< name of the group
     };
 
     /**
@@ -57,8 +76,8 @@ public:
      */
     struct Public
     {
-        std::string addr;       ///< address or value of the symbol
-        std::string name;       ///< name of the symbol
+        Addr addr;                  ///< address or value of the symbol
+        std::string_view name;      ///< name of the symbol
     };
 
     /**
@@ -66,13 +85,208 @@ public:
      */
     struct Import
     {
-        std::string addr;           ///< address of the import, maybe empty
-        std::string name;           ///< name of the import
-        std::string dllName;        ///< dll name of the import
-        std::string dllOrdOrExp;    ///< ordinal of export entry of the import.
-                                    ///< may be empty
+        Addr addr;                      ///< address of the import,
+                                        ///< maybe @ref NoAddr
+        std::string_view name;          ///< name of the import
+        std::string_view dllName;       ///< dll name of the import
+        std::string_view dllOrdOrExp;   ///< ordinal of export entry of the
+                                        ///< import. may be empty
+    };
+
+    /**
+     * Parser state
+     */
+    enum class State {
+        None,               ///< Parsing non-state blocks
+        Segments,           ///< Parsing segments block
+        Groups,             ///< Parsing groups block
+        PublicsByName,      ///< Parsing publics by name block
+        PublicsByValue,     ///< Parsing publics by value block
+        Imports,            ///< Parsing imports block
+        LineNumbers         ///< Parsing line numbers block
+    };
+
+    /**
+     * Sections of a .MAP file to parse. Combined with bitwise OR
+     */
+    enum Section : unsigned {
+        SecSegments         = 1 << 0,   ///< segments block
+        SecGroups           = 1 << 1,   ///< groups block
+        SecPublicsByName    = 1 << 2,   ///< publics by name block
+        SecPublicsByValue   = 1 << 3,   ///< publics by value block
+        SecImports          = 1 << 4,   ///< imports block
+        SecLineNumbers      = 1 << 5,   ///< line numbers blocks
+        SecAll              = ~0u       ///< all the blocks
+    };
+
+    /**
+     * Read-only list of the public symbols in a given order
+     *
+     * Refers to the public symbols through an index list, so it is cheap to
+     * copy.
+     */
+    class PublicList
+    {
+    public:
+        /**
+         * Iterator of the public symbols
+         */
+        class const_iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Public;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const Public *;
+            using reference = const Public&;
+
+            /**
+             * Constructor
+             *
+             * @param[in] publics   Public symbol store
+             * @param[in] it        Position in the index list
+             */
+            const_iterator( const Public *publics, const uint32_t *it )
+                : _publics( publics ), _it( it ) {}
+
+            /**
+             * Get the public symbol at the current position
+             */
+            reference operator*() const { return _publics[ *_it ]; }
+
+            /**
+             * Access the public symbol at the current position
+             */
+            pointer operator->() const { return &_publics[ *_it ]; }
+
+            /**
+             * Move to the next position
+             */
+            const_iterator& operator++() { ++_it; return *this; }
+
+            /**
+             * Move to the next position, and return the old one
+             */
+            const_iterator operator++( int )
+            {
+                auto old = *this;
+                ++_it;
+                return old;
+            }
+
+            /**
+             * operator==
+             */
+            bool operator==( const const_iterator& o ) const
+            {
+                return _it == o._it;
+            }
+
+            /**
+             * operator!=
+             */
+            bool operator!=( const const_iterator& o ) const
+            {
+                return _it != o._it;
+            }
+
+        private:
+            const Public *_publics; ///< public symbol store
+            const uint32_t *_it;    ///< position in the index list
+        };
+
+        /**
+         * Constructor
+         *
+         * @param[in] publics   Public symbol store
+         * @param[in] order     Indexes to @p publics in order
+         */
+        PublicList( const std::vector< Public >& publics,
+                    const std::vector< uint32_t >& order )
+            : _publics( publics ), _order( order ) {}
+
+        /**
+         * Get the iterator to the first public symbol
+         */
+        const_iterator begin() const
+        {
+            return { _publics.data(), _order.data()};
+        }
+
+        /**
+         * Get the iterator past the last public symbol
+         */
+        const_iterator end() const
+        {
+            return { _publics.data(), _order.data() + _order.size()};
+        }
+
+        /**
+         * Get the number of the public symbols
+         */
+        size_t size() const { return _order.size(); }
+
+        /**
+         * Check if there is no public symbol
+         */
+        bool empty() const { return _order.empty(); }
+
+        /**
+         * Get the @p i th public symbol
+         */
+        const Public& operator[]( size_t i ) const
+        {
+            return _publics[ _order[ i ]];
+        }
+
+    private:
+        const std::vector< Public >& _publics;  ///< public symbol store
+        const std::vector< uint32_t >& _order;  ///< indexes in order
     };
 
+    /**
+     * Pack a segment number and an offset into an address
+     *
+     * @param[in] seg   Segment number
+     * @param[in] ofs   Offset
+     * @return          Packed address
+     */
+    static constexpr Addr makeAddr( uint32_t seg, uint32_t ofs )
+    {
+        return ( static_cast< Addr >( seg ) << 32 ) | ofs;
+    }
+
+    /**
+     * Get the segment number of an address
+     */
+    static constexpr uint32_t addrSeg( Addr addr ) { return addr >> 32; }
+
+    /**
+     * Get the offset of an address
+     */
+    static constexpr uint32_t addrOfs( Addr addr )
+    {
+        return static_cast< uint32_t >( addr );
+    }
+
+    /**
+     * Parse a hexadecimal number
+     *
+     * @param[in]  sv   String to parse, such as 0010
+     * @param[out] val  Parsed number
+     * @return          true if success, otherwise false
+     */
+    static bool parseHex( std::string_view sv, uint32_t& val );
+
+    /**
+     * Parse an address
+     *
+     * @param[in]  sv   String to parse, such as ssss:oooo or ssss:oooooooo
+     * @param[out] addr Parsed address
+     * @return          true if success, otherwise false
+     */
+    static bool parseAddr( std::string_view sv, Addr& addr );
+
     /**
      * Constructor
      *
@@ -107,6 +321,58 @@ public:
      */
     bool parse();
 
+    /**
+     * Parse a .MAP file, and pass records to a sink directly
+     *
+     * @param[in] sink  Sink to receive records
+     * @return          true if success, otherwise false
+     * @remark          @p Dialect provides static parseLineTo(),
+     *                  isPublicsBody() and isBlockBody() like KIbmMapParser.
+     *                  @p Sink provides module(), segment(), group(),
+     *                  publicSym(), import(), entry(), lineFile() and
+     *                  lineNumber() like CallbackSink. Both are resolved at
+     *                  compile time, so the calls per line can be inlined.
+     *                  The records of the parser are not touched.
+     */
+    template< typename Dialect, typename Sink >
+    bool parseTo( Sink& sink );
+
+    /**
+     * Sort public symbols by name, and by address
+     *
+     * @param[in]     publics   Public symbol store
+     * @param[in,out] byName    Indexes to @p publics. Sorted by name
+     * @param[out]    byValue   Indexes to @p publics sorted by address or
+     *                          value, and then by name
+     */
+    static void sortPublics( const std::vector< Public >& publics,
+                             std::vector< uint32_t >& byName,
+                             std::vector< uint32_t >& byValue );
+
+    /**
+     * Set the sections to parse
+     *
+     * @param[in] sections  Bitwise OR of @ref Section. @ref SecAll by
+     *                      default
+     * @remark              The blocks of the other sections are skipped
+     *                      without being tokenized. Lines outside of any
+     *                      block, such as a module name and an entry point,
+     *                      are always parsed
+     */
+    void setSections( unsigned sections ) { _sections = sections; }
+
+    /**
+     * Get the sections to parse
+     */
+    unsigned sections() const { return _sections; }
+
+    /**
+     * Set a thread pool to parse large publics blocks in parallel
+     *
+     * @param[in] pool  Thread pool to use. nullptr to parse serially
+     */
+    void setThreadPool( KThreadPool *pool ) { _pool = pool; }
+
     /**
      * Get the module name
      *
@@ -127,17 +393,14 @@ public:
     /**
      * Get the public symbols sorted by name
      */
-    const std::vector< Public >& publicsByName() const
-    {
-        return _publicsByName;
-    }
+    PublicList publicsByName() const { return { _publics, _publicsByName }; }
 
     /**
      * Get the public symbols sorted by address or value
      */
-    const std::vector< Public >& publicsByValue() const
+    PublicList publicsByValue() const
     {
-        return _publicsByValue;
+        return { _publics, _publicsByValue };
     }
 
     /**
@@ -150,40 +413,196 @@ public:
      */
     const std::string& entryPoint() const { return _entryPoint; }
 
+    /**
+     * Set the flag to keep line numbers
+     *
+     * @remark Line numbers blocks are skipped unless set
+     */
+    void setLineNumbers( bool lineNumbers ) { _lineNumbers = lineNumbers; }
+
+    /**
+     * Get the line numbers
+     */
+    const KLineTable& lines() const { return _lines; }
+
 protected:
     /**
-     * Parser state
+     * Sink forwarding records to the callbacks
      */
-    enum class State {
-        None,               ///< Parsing non-state blocks
-        Segments,           ///< Parsing segments block
-        Groups,             ///< Parsing groups block
-        PublicsByName,      ///< Parsing publics by name block
-        PublicsByValue,     ///< Parsing publics by value block
-        Imports             ///< Parsing imports block
+    struct CallbackSink
+    {
+        KMapParser& parser; ///< parser to call back
+
+        /**
+         * Forward a module name to moduleCb()
+         */
+        void module( std::string_view module ) { parser.moduleCb( module ); }
+
+        /**
+         * Forward a segment to segmentCb()
+         */
+        void segment( const Segment& seg ) { parser.segmentCb( seg ); }
+
+        /**
+         * Forward a group to groupCb()
+         */
+        void group( const Group& grp ) { parser.groupCb( grp ); }
+
+        /**
+         * Forward a public symbol to publicCb()
+         */
+        void publicSym( const Public& pub, State st )
+        {
+            parser.publicCb( pub, st );
+        }
+
+        /**
+         * Forward an import to importCb()
+         */
+        void import( const Import& imp ) { parser.importCb( imp ); }
+
+        /**
+         * Forward an entry point to entryCb()
+         */
+        void entry( std::string_view entry ) { parser.entryCb( entry ); }
+
+        /**
+         * Forward a source file of line numbers to lineFileCb()
+         */
+        void lineFile( std::string_view name ) { parser.lineFileCb( name ); }
+
+        /**
+         * Forward a line number to lineNumberCb()
+         */
+        void lineNumber( uint32_t line, Addr addr )
+        {
+            parser.lineNumberCb( line, addr );
+        }
     };
 
     /**
-     * Get the .MAP file name
+     * Sink collecting records from a chunk of a publics block
+     *
+     * Stops at the first line which is not a public symbol or an import.
      */
-    const std::string& fileName() const { return _fileName; }
+    struct PublicsChunk
+    {
+        std::vector< Public > publics;  ///< public symbols
+        std::vector< Import > imports;  ///< imports
+        State pubState = State::None;   ///< state passed with publics
+        size_t parsed = 0;              ///< bytes of the lines parsed
+        size_t lines = 0;               ///< # of the lines parsed
+        bool stop = false;              ///< stopped before the end
+
+        /**
+         * Stop at a module name
+         */
+        void module( std::string_view ) { stop = true; }
+
+        /**
+         * Stop at a segment
+         */
+        void segment( const Segment& ) { stop = true; }
+
+        /**
+         * Stop at a group
+         */
+        void group( const Group& ) { stop = true; }
+
+        /**
+         * Collect a public symbol
+         */
+        void publicSym( const Public& pub, State st )
+        {
+            publics.push_back( pub );
+            pubState = st;
+        }
+
+        /**
+         * Collect an import
+         */
+        void import( const Import& imp ) { imports.push_back( imp ); }
+
+        /**
+         * Stop at an entry point
+         */
+        void entry( std::string_view ) { stop = true; }
+
+        /**
+         * Stop at a source file of line numbers
+         */
+        void lineFile( std::string_view ) { stop = true; }
+
+        /**
+         * Stop at a line number
+         */
+        void lineNumber( uint32_t, Addr ) { stop = true; }
+    };
+
+    /**
+     * Get the next line
+     *
+     * @param[in,out] buf   Buffer to get a line from. Advanced past the line
+     * @return              Line without the line terminator
+     */
+    static std::string_view nextLine( std::string_view& buf );
 
     /**
-     * Get the current parser state
+     * Check if @p sv starts with @p sub
+     *
+     * @param[in] sv    String to check
+     * @param[in] sub   Sub-string to check
+     * @return          true if @p sv starts with @p sub, otherwise false
      */
-    State state() const { return _state; }
+    static bool startsWith( std::string_view sv, std::string_view sub )
+    {
+        return sv.compare( 0, sub.length(), sub ) == 0;
+    }
 
     /**
-     * Set the current parser state
+     * Parse a chunk of a publics block
+     *
+     * @param[in]  text     Lines to parse
+     * @param[in]  st       Parser state at the beginning of @p text
+     * @param[out] chunk    Records parsed
      */
-    void state( State state ) { _state = state; }
+    template< typename Dialect >
+    static void parseChunk( std::string_view text, State st,
+                            PublicsChunk& chunk )
+    {
+        KTokenizer tokenizer;
+        auto buf = text;
+
+        while( !buf.empty())
+        {
+            auto line = nextLine( buf );
+            auto lineSt = st;
+
+            if( !Dialect::parseLineTo( line, tokenizer, lineSt, chunk )
+                || chunk.stop || lineSt != st )
+            {
+                // leave this line to the serial parser
+                chunk.stop = true;
+                break;
+            }
+
+            chunk.parsed = text.size() - buf.size();
+            chunk.lines++;
+        }
+    }
 
     /**
-     * Line parser
+     * Get the .MAP file name
+     */
+    const std::string& fileName() const { return _fileName; }
+
+    /**
+     * Parse a .MAP file, and pass records to the callbacks
      *
-     * @param[in] line  Line to parse
+     * @return true if success, otherwise false
+     * @remark Usually calls parseTo() with CallbackSink
      */
-    virtual bool parseLine( std::string_view line ) = 0;
+    virtual bool parseRecords() = 0;
 
     /**
      * Callback for module name
@@ -229,19 +648,275 @@ protected:
      */
     virtual void entryCb( std::string_view entry );
 
+    /**
+     * Callback for source file of line numbers
+     *
+     * @param[in] name  Source file name
+     */
+    virtual void lineFileCb( std::string_view name );
+
+    /**
+     * Callback for line number
+     *
+     * @param[in] line  Line number
+     * @param[in] addr  Address of the line
+     */
+    virtual void lineNumberCb( uint32_t line, Addr addr );
+
 private:
+    /// min. size of a publics block to parse in parallel
+    static constexpr size_t MinParallelSize = 256 * 1024;
+
+    /// min. size of a chunk of a publics block to parse in parallel
+    static constexpr size_t MinChunkSize = 64 * 1024;
+
     std::string _fileName;  ///< .MAP file name
-    std::ifstream _ifs;     ///< file stream for reading
-    State _state;           ///< parser state
-
-    std::string _moduleName;                ///< module name
-    std::vector< Segment > _segments;       ///< segment list
-    std::vector< Group > _groups;           ///< group list
-    std::vector< Public > _publicsByName;   ///< public list sorted by name
-    std::vector< Public > _publicsByValue;  ///< public list sorted by address
-                                            ///< or value
-    std::vector< Import > _imports;         ///< import list
-    std::string _entryPoint;                ///< entry point address
+    KMappedFile _file;      ///< mapped .MAP file
+    KTokenizer _tokenizer;  ///< line tokenizer
+    KThreadPool *_pool;     ///< thread pool to parse in parallel
+    unsigned _sections;     ///< sections to parse
+
+    std::string _moduleName;                    ///< module name
+    std::vector< Segment > _segments;           ///< segment list
+    std::vector< Group > _groups;               ///< group list
+    std::vector< Public > _publics;             ///< public symbol store
+    std::vector< uint32_t > _publicsByName;     ///< indexes to _publics
+                                                ///< sorted by name
+    std::vector< uint32_t > _publicsByValue;    ///< indexes to _publics
+                                                ///< sorted by address
+                                                ///< or value
+    std::vector< Import > _imports;             ///< import list
+    std::string _entryPoint;                    ///< entry point address
+
+    bool _lineNumbers = false;                  ///< keep line numbers
+    KLineTable _lines;                          ///< line numbers
+
+    /// # of parser states
+    static constexpr size_t StateCount =
+        static_cast< size_t >( State::LineNumbers ) + 1;
+
+    /**
+     * Add statistics of parsing a .MAP file to KStats
+     *
+     * @param[in] bytes     Bytes of the .MAP file
+     * @param[in] skipped   Bytes of the blocks skipped
+     * @param[in] lines     # of lines parsed in each state
+     */
+    static void addStats( size_t bytes, size_t skipped,
+                          const size_t ( &lines )[ StateCount ]);
+
+    /**
+     * Print an unexpected line
+     *
+     * @param[in] line  Line
+     * @return          false always
+     */
+    static bool unexpectedLine( std::string_view line );
+
+    /**
+     * Get the section of a parser state
+     *
+     * @param[in] st    Parser state
+     * @return          @ref Section of @p st. 0 for the states always
+     *                  parsed
+     */
+    static constexpr unsigned sectionOf( State st )
+    {
+        switch( st )
+        {
+            case State::Segments:       return SecSegments;
+            case State::Groups:         return SecGroups;
+            case State::PublicsByName:  return SecPublicsByName;
+            case State::PublicsByValue: return SecPublicsByValue;
+            case State::Imports:        return SecImports;
+            case State::LineNumbers:    return SecLineNumbers;
+            default:                    return 0;
+        }
+    }
+
+    /**
+     * Get the body of the current block to skip
+     *
+     * @param[in] buf   Buffer starting from the body
+     * @param[in] st    Parser state of the block
+     * @return          Lines of @p buf accepted by Dialect::isBlockBody()
+     */
+    template< typename Dialect >
+    static std::string_view blockBody( std::string_view buf, State st )
+    {
+        auto rest = buf;
+
+        while( !rest.empty())
+        {
+            auto next = rest;
+
+            if( !Dialect::isBlockBody( st, nextLine( next )))
+                break;
+
+            rest = next;
+        }
+
+        return buf.substr( 0, buf.size() - rest.size());
+    }
+
+    /**
+     * Get the body of the current publics block
+     *
+     * @param[in] buf   Buffer starting from the body
+     * @return          Lines of @p buf accepted by Dialect::isPublicsBody()
+     */
+    template< typename Dialect >
+    static std::string_view publicsBody( std::string_view buf )
+    {
+        auto rest = buf;
+
+        while( !rest.empty())
+        {
+            auto next = rest;
+
+            if( !Dialect::isPublicsBody( nextLine( next )))
+                break;
+
+            rest = next;
+        }
+
+        return buf.substr( 0, buf.size() - rest.size());
+    }
+
+    /**
+     * Split the body of a publics block into line-aligned chunks
+     *
+     * @param[in] body  Lines returned by publicsBody()
+     * @return          Chunks of @p body in order
+     */
+    std::vector< std::string_view > splitChunks( std::string_view body ) const;
+
+    /**
+     * Parse the body of a publics block in parallel
+     *
+     * @param[in] body  Lines returned by publicsBody()
+     * @param[in] st    Parser state of the publics block
+     * @param[in] sink  Sink to receive records in file order
+     * @param[out] nLines   # of lines parsed
+     * @return          Bytes of @p body parsed
+     * @remark          Stops at the line where the serial parser should
+     *                  take over
+     */
+    template< typename Dialect, typename Sink >
+    size_t parsePublicsBody( std::string_view body, State st, Sink& sink,
+                             size_t& nLines )
+    {
+        auto texts = splitChunks( body );
+        std::vector< PublicsChunk > chunks( texts.size());
+
+        _pool->run( texts.size(), [ & ]( size_t i )
+        {
+            parseChunk< Dialect >( texts[ i ], st, chunks[ i ]);
+        });
+
+        // merge in file order
+        size_t parsed = 0;
+
+        for( size_t i = 0; i < chunks.size(); i++ )
+        {
+            for( const auto& pub: chunks[ i ].publics )
+                sink.publicSym( pub, chunks[ i ].pubState );
+
+            for( const auto& imp: chunks[ i ].imports )
+                sink.import( imp );
+
+            nLines += chunks[ i ].lines;
+
+            if( chunks[ i ].stop )
+                return parsed + chunks[ i ].parsed;
+
+            parsed += texts[ i ].size();
+        }
+
+        return parsed;
+    }
 };
 
+template< typename Dialect, typename Sink >
+bool KMapParser::parseTo( Sink& sink )
+{
+    KStats::Timer timer( KStats::Phase::Parse );
+
+    auto buf = _file.view();
+    auto st = State::None;
+
+    // for statistics
+    size_t lines[ StateCount ] = {};
+    size_t skipped = 0;
+
+    auto parseLine = [ & ]( std::string_view line )
+    {
+        bool ok = Dialect::parseLineTo( line, _tokenizer, st, sink )
+                  || unexpectedLine( line );
+
+        lines[ static_cast< size_t >( st )]++;
+
+        return ok;
+    };
+
+    while( !buf.empty())
+    {
+        auto section = sectionOf( st );
+
+        if( section != 0 && !( _sections & section ))
+        {
+            // skip the block not requested up to the next header
+            auto body = blockBody< Dialect >( buf, st );
+
+            buf.remove_prefix( body.size());
+            skipped += body.size();
+
+            if( buf.empty())
+                break;
+        }
+        else if( _pool && _pool->size() > 1
+                 && ( st == State::PublicsByName
+                      || st == State::PublicsByValue ))
+        {
+            auto body = publicsBody< Dialect >( buf );
+
+            // parse the large body in parallel
+            if( body.size() >= MinParallelSize )
+            {
+                size_t nLines = 0;
+                auto parsed = parsePublicsBody< Dialect >( body, st, sink,
+                                                           nLines );
+
+                buf.remove_prefix( parsed );
+                lines[ static_cast< size_t >( st )] += nLines;
+
+                // let the serial parser take over the line stopped at
+                if( parsed < body.size() && !parseLine( nextLine( buf )))
+                    return false;
+
+                continue;
+            }
+
+            // parse the small body serially at once not to scan it again
+            buf.remove_prefix( body.size());
+
+            while( !body.empty())
+            {
+                if( !parseLine( nextLine( body )))
+                    return false;
+            }
+
+            if( buf.empty())
+                break;
+        }
+
+        if( !parseLine( nextLine( buf )))
+            return false;
+    }
+
+    addStats( _file.view().size(), skipped, lines );
+
+    return true;
+}
+
 #endif
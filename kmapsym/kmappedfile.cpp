@@ -0,0 +1,169 @@
+/*
+ * KMappedFile
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "kmappedfile.h"
+
+#include <fstream>
+#include <string>
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#define USE_MMAP
+
+#include <cerrno>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <filesystem>
+#endif
+
+/// size of a chunk to read a file not mapped
+static constexpr size_t ReadChunkSize = 64 * 1024;
+
+KMappedFile::KMappedFile()
+    : _data( nullptr )
+    , _size( 0 )
+    , _open( false )
+    , _mapped( false )
+{
+}
+
+KMappedFile::~KMappedFile()
+{
+    close();
+}
+
+bool KMappedFile::open( std::string_view fileName )
+{
+    close();
+
+    std::string name( fileName );
+
+#ifdef USE_MMAP
+    int fd = ::open( name.c_str(), O_RDONLY );
+    if( fd == -1 )
+        return false;
+
+    struct stat st;
+
+    if( fstat( fd, &st ) == -1 )
+    {
+        ::close( fd );
+
+        return false;
+    }
+
+    // only regular files have their size to map
+    if( S_ISREG( st.st_mode ) && st.st_size > 0 )
+    {
+        void *p = mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if( p != MAP_FAILED )
+        {
+            madvise( p, st.st_size, MADV_SEQUENTIAL );
+
+            _data = static_cast< const char * >( p );
+            _size = st.st_size;
+            _mapped = true;
+        }
+    }
+
+    bool ok = true;
+
+    // read the others, for example, pipes until EOF
+    while( !_mapped )
+    {
+        size_t len = _buf.size();
+
+        _buf.resize( len + ReadChunkSize );
+
+        auto n = ::read( fd, _buf.data() + len, ReadChunkSize );
+
+        _buf.resize( len + ( n > 0 ? n : 0 ));
+
+        if( n == -1 && errno == EINTR )
+            continue;
+
+        if( n <= 0 )
+        {
+            ok = n == 0;
+
+            break;
+        }
+    }
+
+    ::close( fd );
+#else
+    std::ifstream ifs( name, std::ios::in | std::ios::binary );
+    if( !ifs )
+        return false;
+
+    std::error_code ec;
+    auto size = std::filesystem::file_size( name, ec );
+
+    // not to grow the buffer repeatedly for a regular file
+    if( !ec )
+        _buf.reserve( size + ReadChunkSize );
+
+    // read in chunks until EOF not to seek, which fails on pipes
+    for(;;)
+    {
+        size_t len = _buf.size();
+
+        _buf.resize( len + ReadChunkSize );
+        ifs.read( _buf.data() + len, ReadChunkSize );
+        _buf.resize( len + ifs.gcount());
+
+        if( !ifs )
+            break;
+    }
+
+    bool ok = !ifs.bad();
+#endif
+
+    if( !ok )
+    {
+        _buf.clear();
+
+        return false;
+    }
+
+    if( !_mapped )
+    {
+        _data = _buf.data();
+        _size = _buf.size();
+    }
+
+    _open = true;
+
+    return true;
+}
+
+void KMappedFile::close()
+{
+#ifdef USE_MMAP
+    if( _mapped )
+        munmap( const_cast< char * >( _data ), _size );
+#endif
+
+    _buf.clear();
+
+    _data = nullptr;
+    _size = 0;
+    _open = false;
+    _mapped = false;
+}
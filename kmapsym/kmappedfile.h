@@ -0,0 +1,92 @@
+/*
+ * KMappedFile
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KMAPPEDFILE_H
+#define KMAPSYM_KMAPPEDFILE_H
+
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+
+/**
+ * Read-only memory-mapped file class
+ *
+ * Maps the whole file into memory. On the platforms without mmap(), the file
+ * is read into a single buffer instead.
+ */
+class KMappedFile
+{
+public:
+    /**
+     * Constructor
+     */
+    KMappedFile();
+
+    /**
+     * Destructor
+     */
+    ~KMappedFile();
+
+    /**
+     * Copy constructor
+     */
+    KMappedFile( const KMappedFile& ) = delete;
+
+    /**
+     * operator=
+     */
+    KMappedFile& operator=( const KMappedFile& ) = delete;
+
+    /**
+     * Map a file
+     *
+     * @param[in] fileName  File name to map
+     * @return              true if success, otherwise false
+     */
+    bool open( std::string_view fileName );
+
+    /**
+     * Unmap a file
+     */
+    void close();
+
+    /**
+     * Check if a file is mapped
+     */
+    bool isOpen() const { return _open; }
+
+    /**
+     * Get the contents of a file
+     *
+     * @remark Valid until close() is called
+     */
+    std::string_view view() const { return { _data, _size }; }
+
+    /**
+     * Get the size of a file
+     */
+    size_t size() const { return _size; }
+
+private:
+    const char *_data;          ///< contents of a file
+    size_t _size;               ///< size of a file
+    bool _open;                 ///< open indicator
+    bool _mapped;               ///< true if mapped, false if read
+    std::vector< char > _buf;   ///< buffer if not mapped
+};
+
+#endif
@@ -18,12 +18,35 @@
 #include "kibmmapparser.h"
 #include "kwatcommapparser.h"
 #include "ksymwriter.h"
+#include "ksymindexwriter.h"
+#include "ksymcache.h"
+#include "kmappedfile.h"
+#include "klinetable.h"
+#include "kspillsorter.h"
+#include "kthreadpool.h"
+#include "klocalsocket.h"
 #include "kverbose.h"
+#include "kstats.h"
 
 #include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
 #include <filesystem>
-
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
 #include <string_view>
+#include <vector>
+
+#include <csignal>
+#include <cstdlib>
 
 /**
  * .MAP file parser type
@@ -36,6 +59,108 @@ enum class KMapParserType {
 
 #define verb KVerbose::instance()
 
+/**
+ * Helper to print an address in ssss:oooooooo form
+ */
+struct AddrFmt
+{
+    KMapParser::Addr addr;  ///< address to print
+};
+
+/**
+ * Print an address in ssss:oooooooo form
+ *
+ * @param[in] os    Output stream
+ * @param[in] a     Address to print
+ * @return          @p os
+ * @remark          Prints nothing for @ref KMapParser::NoAddr
+ */
+static std::ostream& operator<<( std::ostream& os, AddrFmt a )
+{
+    if( a.addr == KMapParser::NoAddr )
+        return os;
+
+    auto flags = os.flags();
+    auto fill = os.fill('0');
+
+    os << std::hex << std::uppercase
+       << std::setw( 4 ) << KMapParser::addrSeg( a.addr ) << ":"
+       << std::setw( 8 ) << KMapParser::addrOfs( a.addr );
+
+    os.fill( fill );
+    os.flags( flags );
+
+    return os;
+}
+
+/**
+ * Helper to print a length in hexadecimal
+ */
+struct LenFmt
+{
+    uint32_t len;   ///< length to print
+};
+
+/**
+ * Print a length in hexadecimal
+ *
+ * @param[in] os    Output stream
+ * @param[in] l     Length to print
+ * @return          @p os
+ */
+static std::ostream& operator<<( std::ostream& os, LenFmt l )
+{
+    auto flags = os.flags();
+    auto fill = os.fill('0');
+
+    os << std::hex << std::uppercase << std::setw( 8 ) << l.len;
+
+    os.fill( fill );
+    os.flags( flags );
+
+    return os;
+}
+
+/**
+ * Options
+ */
+struct Options
+{
+    KMapParserType parserType = KMapParserType::Ibm;    ///< .MAP file type
+    bool omitAlphaSort = false;         ///< omit alphabetical sorting
+    bool lineNumbers = false;           ///< include line numbers
+    bool reportLimits = false;          ///< report usage of .SYM limits
+    KVerbose::Level level = KVerbose::Level::Normal;    ///< verbose level
+    bool writeIndex = false;            ///< write .KSI file, too
+    size_t jobs = 0;                    ///< # of concurrent conversions.
+                                        ///< 0 for # of hardware threads
+    bool cache = false;                 ///< skip up-to-date .SYM files
+    std::string cacheDir;               ///< cache directory of .SYM files
+    bool stats = false;                 ///< print statistics
+    std::string statsFile;              ///< file to write statistics to.
+                                        ///< empty for stdout
+    std::string dir;                    ///< directory of relative paths.
+                                        ///< empty for the current one
+    size_t memory = 0;                  ///< memory budget of a conversion
+                                        ///< in bytes. 0 for no limit
+    std::string serve;                  ///< socket path to serve
+                                        ///< requests on. empty for none
+    std::vector< std::string > files;   ///< .MAP files to convert
+};
+
+/**
+ * Conversion status
+ */
+enum class Status
+{
+    Ok,             ///< converted successfully
+    UpToDate,       ///< .SYM file is up to date
+    MapOpenFailed,  ///< failed to open a .MAP file
+    ParseFailed,    ///< failed to parse a .MAP file
+    OpenFailed,     ///< failed to open a .SYM file
+    WriteFailed     ///< failed to write a .SYM file
+};
+
 /**
  * Show usage
  *
@@ -44,7 +169,8 @@ enum class KMapParserType {
 static void showUsage()
 {
     verb.out() << "\
-Usage: kmapsym map_type [options] filename[.map]\n\
+Usage: kmapsym map_type [options] filename[.map]... | @response_file\n\
+       kmapsym --serve=path [-l] [-j N]\n\
 map_type:\n\
     -i: IBM map file (default)\n\
     -w: Watcom map file\n\
@@ -52,183 +178,1368 @@ options:\n\
     -a: Omit alphabetical sorting of symbols\n\
     -l: Produce verbose listing\n\
     -ll: Produce more verbose listing\n\
-    -n: Include source code line numbers in .SYM file (ignored)\n\
+    -n: Include source code line numbers in .SYM file\n\
+    -r: Report how close segments are to the limits of .SYM format\n\
+    -x: Write .KSI index file without the limits of .SYM format, too\n\
+    -j N: Convert N files concurrently (default: # of CPUs)\n\
+    -c: Skip conversion if .MAP file and options are not changed\n\
+    -C dir: Same as -c, and keep .SYM files in cache directory dir\n\
+    --stats[=file]: Print time and counts of phases in JSON to file or\n\
+                    stdout\n\
+    --memory=N: Keep heap memory within about N MB by spilling sorted\n\
+                symbols and line numbers to temporary files. Not\n\
+                applied with -ll or -x\n\
+    --serve=path: Serve conversions requested on local socket path until\n\
+                  interrupted. -j N sets the # of concurrent requests\n\
+    --server=path: Request the conversion to the server on path. -j N is\n\
+                   ignored\n\
+response_file:\n\
+    A file listing .MAP files, one per line\n\
 ";
 }
 
-int main( int argc, char *argv[])
+/**
+ * Read .MAP file names from a response file
+ *
+ * @param[in]  fileName  Response file name
+ * @param[out] files     List to append .MAP file names to
+ * @return               true if success, otherwise false
+ */
+static bool readResponseFile( const std::string& fileName,
+                              std::vector< std::string >& files )
 {
-    std::string arg;
-    std::filesystem::path mapPath;
+    std::ifstream ifs( fileName );
+    if( !ifs )
+        return false;
+
+    std::string line;
 
-    KMapParserType parserType = KMapParserType::Ibm;
-    std::unique_ptr< KMapParser > parser;
+    while( std::getline( ifs, line ))
+    {
+        auto start = line.find_first_not_of(" \t\r");
+        if( start == std::string::npos )
+            continue;
 
-    bool omitAlphaSort = false;
+        auto end = line.find_last_not_of(" \t\r");
 
-    if( argc < 2 )
+        files.push_back( line.substr( start, end - start + 1 ));
+    }
+
+    return true;
+}
+
+/**
+ * Create a .MAP file parser
+ *
+ * @param[in] type  .MAP file type
+ * @return          .MAP file parser
+ */
+static std::unique_ptr< KMapParser > createParser( KMapParserType type )
+{
+    if( type == KMapParserType::Ibm )
+        return std::make_unique< KIbmMapParser >();
+
+    return std::make_unique< KWatcomMapParser >();
+}
+
+/**
+ * Print the header of the listing
+ *
+ * @param[in] symPath   .SYM file path
+ * @param[in] mapPath   .MAP file path
+ * @param[in] bits      # of bits of the map
+ */
+static void showHeader( const std::filesystem::path& symPath,
+                        const std::filesystem::path& mapPath, int bits )
+{
+    verb.info() << "Building " << symPath.string() << "\n"
+                << mapPath.string() << "\n";
+
+    verb.info() << bits << "-bit LE map\n";
+}
+
+/**
+ * Sink passing records of a .MAP file to a .SYM writer directly
+ *
+ * Segments and public symbols by value go to the writer as they are parsed.
+ * Groups are held until the first symbol, so that the header of the listing
+ * is printed before the messages of the writer. Public symbols by name are
+ * held until publics by value appear, because Watcom .MAP files have only
+ * unsorted publics by name.
+ */
+struct WriterSink
+{
+    KSymWriter& writer;                     ///< writer to pass records to
+    const std::filesystem::path& symPath;   ///< .SYM file path
+    const std::filesystem::path& mapPath;   ///< .MAP file path
+    bool lineNumbers;                       ///< keep line numbers
+    size_t memory;                          ///< memory budget in bytes.
+                                            ///< 0 for no limit
+
+    KLineTable lines;                       ///< line numbers
+    std::vector< KMapParser::Group > groups;        ///< groups held
+    std::vector< KMapParser::Public > publics;      ///< publics by name held
+    std::unique_ptr< KSpillSorter > sorter; ///< publics by name to sort
+                                            ///< within memory budget
+    bool failed = false;                    ///< failed to hold records
+    std::string_view entryPoint;            ///< entry point address
+    int bits = 16;                          ///< # of bits of the map
+    bool started = false;                   ///< groups passed
+    bool byValue = false;                   ///< publics by value appeared
+
+    /**
+     * Pass a module name
+     */
+    void module( std::string_view module ) { writer.setModuleName( module ); }
+
+    /**
+     * Pass a segment
+     */
+    void segment( const KMapParser::Segment& seg )
     {
-        showUsage();
+        if( seg.nBits == 32 )
+            bits = 32;
 
-        return 1;
+        writer.addSegment( seg );
     }
 
-    for( int i = 1; i < argc; i++ )
+    /**
+     * Hold a group
+     */
+    void group( const KMapParser::Group& grp ) { groups.push_back( grp ); }
+
+    /**
+     * Pass a public symbol by value, or hold a public symbol by name
+     */
+    void publicSym( const KMapParser::Public& pub, KMapParser::State st )
     {
-        arg = argv[ i ];
-        if( arg.compare("-i") == 0 )
-            parserType = KMapParserType::Ibm;
-        else if( arg.compare("-w") == 0 )
-            parserType = KMapParserType::Watcom;
-        else if( arg.compare("-a") == 0 )
-            omitAlphaSort = true;
-        else if( arg.compare("-l") == 0 )
-             verb.level( KVerbose::Level::Info );
-        else if( arg.compare("-ll") == 0 )
-            verb.level( KVerbose::Level::Debug );
-        else if( arg.compare("-n") == 0 )
-            /* ignore */;
-        else
+        start();
+
+        if( st == KMapParser::State::PublicsByValue )
+        {
+            byValue = true;
+
+            writer.addSymbol( pub );
+        }
+        else if( st == KMapParser::State::PublicsByName && !byValue )
         {
-            if( !mapPath.empty())
+            if( memory == 0 )
+                publics.push_back( pub );
+            else
             {
-                verb.err() << "Multiple file names specified!!!\n";
-                showUsage();
+                // half of the budget for sorting
+                if( !sorter )
+                    sorter = std::make_unique< KSpillSorter >( memory / 2 );
 
-                return 1;
+                if( !sorter->add( pub ))
+                    failed = true;
             }
-
-            mapPath = arg;
         }
     }
 
-    if( mapPath.empty())
+    /**
+     * Ignore an import
+     */
+    void import( const KMapParser::Import& ) {}
+
+    /**
+     * Keep an entry point
+     */
+    void entry( std::string_view entry ) { entryPoint = entry; }
+
+    /**
+     * Start lines of a source file
+     */
+    void lineFile( std::string_view name )
     {
-        verb.err() << "Missing .MAP file name!!!\n";
-        showUsage();
+        if( lineNumbers )
+            lines.addFile( name );
+    }
 
-        return 1;
+    /**
+     * Add a line number
+     */
+    void lineNumber( uint32_t line, KMapParser::Addr addr )
+    {
+        if( lineNumbers )
+            lines.addLine( line, KMapParser::addrSeg( addr ),
+                           KMapParser::addrOfs( addr ));
     }
 
-    if( mapPath.extension().empty())
-        mapPath += ".map";
+    /**
+     * Print the header of the listing, and pass the groups held
+     */
+    void start()
+    {
+        if( started )
+            return;
 
-    if( parserType == KMapParserType::Ibm )
-        parser = std::make_unique< KIbmMapParser >( mapPath.string());
-    else
-        parser = std::make_unique< KWatcomMapParser >( mapPath.string());
+        started = true;
 
-    if( !parser )
-    {
-        verb.err() << "Out of memory!!!\n";
+        showHeader( symPath, mapPath, bits );
 
-        return 1;
+        for( const auto& grp: groups )
+            writer.addGroup( grp );
     }
 
-    if( parser->open() && parser->parse())
+    /**
+     * Pass the records held at the end of a .MAP file
+     *
+     * @return true if success, otherwise false
+     */
+    bool finish()
     {
-        auto symPath = mapPath;
-        symPath.replace_extension(".sym");
+        start();
 
-        KSymWriter writer( symPath.string());
+        if( failed )
+            return false;
 
-        if( !writer.open())
-            return 1;
+        if( byValue )
+            return true;
 
-        writer.setOmitAlphaSort( omitAlphaSort );
+        if( sorter )
+        {
+            KMapParser::Public pub;
 
-        verb.info() << "Building " << symPath.string() << "\n"
-                    << mapPath.string() << "\n";
+            if( !sorter->finish())
+                return false;
 
-        int bits = 16;
-        for( const auto& seg: parser->segments())
-        {
-            if( seg.nBits == 32 )
-                bits = 32;
+            while( sorter->next( pub ))
+                writer.addSymbol( pub );
 
+            return !sorter->failed();
         }
-        verb.info() << bits << "-bit LE map\n";
 
-        verb.debug() << "MODULE: " << parser->moduleName() << "\n"
-                     << "\n";
+        // only publics by name, sort them by value as KMapParser::parse()
+        std::vector< uint32_t > byName( publics.size());
+        std::vector< uint32_t > order;
 
-        writer.setModuleName( parser->moduleName());
+        for( uint32_t i = 0; i < byName.size(); i++ )
+            byName[ i ] = i;
 
-        for( const auto& seg: parser->segments())
-        {
-            verb.debug() << "SEGMENT: "
-                         << seg.addr << "\t"
-                         << seg.length << "\t"
-                         << seg.name << "\t"
-                         << seg.className << "\t"
-                         << seg.nBits << "-Bit" << "\n";
+        KMapParser::sortPublics( publics, byName, order );
 
-            writer.addSegment( seg );
-        }
+        for( auto i: order )
+            writer.addSymbol( publics[ i ]);
 
-        verb.debug() << "\n";
+        return true;
+    }
+};
 
-        for( const auto& group: parser->groups())
-        {
-            verb.debug() << "GROUP: "
-                         << group.addr << "\t"
-                         << group.length << "\t"
-                         << group.name << "\n";
+/**
+ * Parse a .MAP file, and pass records to a .SYM writer directly
+ *
+ * @param[in] parser    Parser with a .MAP file open
+ * @param[in] type      .MAP file type
+ * @param[in] sink      Sink passing records to a writer
+ * @return              true if success, otherwise false
+ */
+static bool parseToWriter( KMapParser& parser, KMapParserType type,
+                           WriterSink& sink )
+{
+    bool ok = type == KMapParserType::Ibm ?
+              parser.parseTo< KIbmMapParser >( sink ) :
+              parser.parseTo< KWatcomMapParser >( sink );
 
-            writer.addGroup( group );
-        }
+    return ok && sink.finish();
+}
+
+/**
+ * Pass records kept by a parser to a .SYM writer with the listing
+ *
+ * @param[in] parser    Parser which parsed a .MAP file
+ * @param[in] writer    Writer to pass records to
+ * @param[in] symPath   .SYM file path
+ * @param[in] mapPath   .MAP file path
+ */
+static void addRecords( const KMapParser& parser, KSymWriter& writer,
+                        const std::filesystem::path& symPath,
+                        const std::filesystem::path& mapPath )
+{
+    int bits = 16;
+    for( const auto& seg: parser.segments())
+    {
+        if( seg.nBits == 32 )
+            bits = 32;
+
+    }
+
+    showHeader( symPath, mapPath, bits );
+
+    verb.debug() << "MODULE: " << parser.moduleName() << "\n"
+                 << "\n";
+
+    writer.setModuleName( parser.moduleName());
+    writer.reserve( parser.segments().size() + parser.groups().size(),
+                    parser.publicsByValue().size());
+
+    for( const auto& seg: parser.segments())
+    {
+        KVERBOSE_DEBUG << "SEGMENT: "
+                       << AddrFmt{ seg.addr } << "\t"
+                       << LenFmt{ seg.length } << "\t"
+                       << seg.name << "\t"
+                       << seg.className << "\t"
+                       << seg.nBits << "-Bit" << "\n";
+
+        writer.addSegment( seg );
+    }
+
+    verb.debug() << "\n";
+
+    for( const auto& group: parser.groups())
+    {
+        KVERBOSE_DEBUG << "GROUP: "
+                       << AddrFmt{ group.addr } << "\t"
+                       << LenFmt{ group.length } << "\t"
+                       << group.name << "\n";
+
+        writer.addGroup( group );
+    }
 
-        verb.debug() << "\n";
+    verb.debug() << "\n";
 
-        for( const auto& pub: parser->publicsByName())
+    if( verb.isDebug())
+    {
+        for( const auto& pub: parser.publicsByName())
         {
             verb.debug() << "PUBLIC BY NAME: "
-                         << pub.addr << "\t"
+                         << AddrFmt{ pub.addr } << "\t"
                          << pub.name << "\n";
         }
+    }
 
-        verb.debug() << "\n";
+    verb.debug() << "\n";
 
-        for( const auto& pub: parser->publicsByValue())
-        {
-            verb.debug() << "PUBLIC BY VALUE: "
-                         << pub.addr << "\t"
-                         << pub.name << "\n";
+    for( const auto& pub: parser.publicsByValue())
+    {
+        KVERBOSE_DEBUG << "PUBLIC BY VALUE: "
+                       << AddrFmt{ pub.addr } << "\t"
+                       << pub.name << "\n";
 
-            writer.addSymbol( pub );
-        }
+        writer.addSymbol( pub );
+    }
 
-        verb.debug() << "\n";
+    verb.debug() << "\n";
 
-        for( const auto& imp: parser->imports())
+    if( verb.isDebug())
+    {
+        for( const auto& imp: parser.imports())
         {
             verb.debug() << "IMPORT: "
-                         << imp.addr << "\t"
+                         << AddrFmt{ imp.addr } << "\t"
                          << imp.name << "\t"
                          << imp.dllName << "\t"
                          << imp.dllOrdOrExp << "\n";
         }
+    }
+}
+
+/**
+ * Resolve a path against a directory
+ *
+ * @param[in] dir   Directory. Empty for the current directory
+ * @param[in] path  Path to resolve
+ * @return          @p path if it is absolute or @p dir is empty, otherwise
+ *                  @p path in @p dir
+ */
+static std::string resolvePath( const std::string& dir,
+                                const std::string& path )
+{
+    std::filesystem::path p( path );
+
+    if( dir.empty() || p.is_absolute())
+        return path;
+
+    return ( std::filesystem::path( dir ) / p ).string();
+}
+
+/**
+ * Convert a .MAP file to a .SYM file
+ *
+ * @param[in] parser    Parser to use
+ * @param[in] writer    Writer to use
+ * @param[in] mapPath   .MAP file path
+ * @param[in] opts      Options
+ * @return              Conversion status
+ */
+static Status convert( KMapParser& parser, KSymWriter& writer,
+                       std::filesystem::path mapPath, const Options& opts )
+{
+    if( mapPath.extension().empty())
+        mapPath += ".map";
+
+    auto symPath = mapPath;
+    symPath.replace_extension(".sym");
+
+    auto ksiPath = mapPath;
+    ksiPath.replace_extension(".ksi");
+
+    // open the files in opts.dir
+    auto mapFile = resolvePath( opts.dir, mapPath.string());
+    auto symFile = resolvePath( opts.dir, symPath.string());
+    auto ksiFile = resolvePath( opts.dir, ksiPath.string());
+
+    KSymCache cache( opts.cacheDir );
+    uint64_t key = 0;
+
+    if( opts.cache )
+    {
+        KMappedFile map;
+
+        if( !map.open( mapFile ))
+            return Status::MapOpenFailed;
+
+        // options affecting .SYM files
+        std::string options;
+
+        options += opts.parserType == KMapParserType::Ibm ? "-i" : "-w";
+        if( opts.omitAlphaSort )
+            options += " -a";
+        if( opts.lineNumbers )
+            options += " -n";
+        if( opts.writeIndex )
+            options += " -x";
+
+        key = KSymCache::key( map.view(), options );
+
+        // .KSI file is not cached. it is written with .SYM file
+        std::error_code ec;
+        bool hasIndex = !opts.writeIndex
+                        || std::filesystem::is_regular_file( ksiFile, ec );
+
+        // a report needs conversion
+        if( !opts.reportLimits && hasIndex
+            && cache.lookup( symFile, key ))
+        {
+            verb.info() << symPath.string() << " is up to date\n";
+
+            return Status::UpToDate;
+        }
+    }
+
+    parser.setLineNumbers( opts.lineNumbers );
+
+    if( !parser.open( mapFile ))
+        return Status::MapOpenFailed;
+
+    writer.clear();
+
+    // the index and the debug listing need the records kept by the parser
+    bool direct = !opts.writeIndex
+                  && verb.level() < KVerbose::Level::Debug;
+    WriterSink sink{ writer, symPath, mapPath, opts.lineNumbers,
+                     opts.memory };
+    std::string_view entryPoint;
+
+    if( direct )
+    {
+        // skip the blocks the writer does not use. IBM maps have both
+        // publics by name and by value
+        unsigned sections = KMapParser::SecSegments | KMapParser::SecGroups;
+
+        sections |= opts.parserType == KMapParserType::Ibm ?
+                    KMapParser::SecPublicsByValue :
+                    KMapParser::SecPublicsByName;
+
+        if( opts.lineNumbers )
+            sections |= KMapParser::SecLineNumbers;
+
+        parser.setSections( sections );
+
+        // a quarter of the budget for line numbers
+        sink.lines.setSpillSize( opts.memory / 4 );
+
+        if( !parseToWriter( parser, opts.parserType, sink ))
+            return Status::ParseFailed;
+
+        entryPoint = sink.entryPoint;
+    }
+    else
+    {
+        parser.setSections( KMapParser::SecAll );
+
+        if( !parser.parse())
+            return Status::ParseFailed;
+
+        addRecords( parser, writer, symPath, mapPath );
+
+        entryPoint = parser.entryPoint();
+    }
+
+    if( !writer.open( symPath.string(), opts.dir ))
+        return Status::OpenFailed;
+
+    writer.setOmitAlphaSort( opts.omitAlphaSort );
+    writer.setReportLimits( opts.reportLimits );
+
+    if( opts.lineNumbers )
+        writer.setLineTable( direct ? &sink.lines : &parser.lines());
+
+    verb.out() << "\n";
+
+    if( entryPoint.empty())
+    {
+        std::string_view entryPoint("0000:0010");
+
+        verb.out() << "No entry point, assume " << entryPoint << "\n";
+
+        writer.setEntryPoint( entryPoint );
+    }
+    else
+    {
+        verb.out() << "Program entry point at " << entryPoint << "\n";
+
+        writer.setEntryPoint( entryPoint );
+    }
+
+    if( !writer.write())
+        return Status::WriteFailed;
+
+    if( opts.writeIndex )
+    {
+        KSymIndexWriter index;
+
+        verb.info() << "Writing " << ksiPath.string() << "\n";
+
+        if( !index.write( ksiFile, parser ))
+            return Status::WriteFailed;
+    }
+
+    if( opts.cache )
+    {
+        // flush .SYM file before storing it
+        writer.close();
+
+        if( !cache.store( symFile, key ))
+            verb.err() << "Cannot store " << symPath.string()
+                       << " in the cache!!!\n";
+    }
+
+    return Status::Ok;
+}
+
+/**
+ * Print the status of each file converted
+ *
+ * @param[in] files     .MAP files
+ * @param[in] statuses  Conversion status of each file
+ * @return              true if all the files are converted, otherwise false
+ */
+static bool showSummary( const std::vector< std::string >& files,
+                         const std::vector< Status >& statuses )
+{
+    size_t nFiles = files.size();
+    size_t nFailed = 0;
+
+    verb.out() << "\n";
 
-        verb.out() << "\n";
+    for( size_t i = 0; i < nFiles; i++ )
+    {
+        const char *status = "ok";
 
-        if( parser->entryPoint().empty())
+        switch( statuses[ i ])
         {
-            std::string_view entryPoint("0000:0010");
+            case Status::UpToDate:
+                status = "up to date";
+                break;
+
+            case Status::MapOpenFailed:
+                status = "failed to open .MAP file";
+                break;
+
+            case Status::ParseFailed:
+                status = "failed to parse";
+                break;
+
+            case Status::OpenFailed:
+                status = "failed to open .SYM file";
+                break;
 
-            verb.out() << "No entry point, assume " << entryPoint << "\n";
+            case Status::WriteFailed:
+                status = "failed to write .SYM file";
+                break;
 
-            writer.setEntryPoint( entryPoint );
+            default:
+                break;
         }
-        else
+
+        if( statuses[ i ] != Status::Ok && statuses[ i ] != Status::UpToDate )
+            ++nFailed;
+
+        verb.out() << files[ i ] << ": " << status << "\n";
+    }
+
+    verb.out() << nFiles - nFailed << " of " << nFiles
+               << " file" << ( nFiles > 1 ? "s" : "") << " converted\n";
+
+    return nFailed == 0;
+}
+
+/**
+ * Convert .MAP files concurrently
+ *
+ * @param[in] opts  Options
+ * @param[in] pool  Thread pool to use
+ * @return          true if all the files are converted, otherwise false
+ */
+static bool convertAll( const Options& opts, KThreadPool& pool )
+{
+    size_t nFiles = opts.files.size();
+    size_t nWorkers = std::min( pool.size(), nFiles );
+    std::vector< Status > statuses( nFiles );
+    std::atomic< size_t > next{ 0 };
+    std::mutex outMutex;
+
+    // share the memory budget among the concurrent conversions
+    Options fileOpts = opts;
+    fileOpts.memory = opts.memory / nWorkers;
+
+    // each worker reuses its parser and writer across files
+    pool.run( nWorkers, [ & ]( size_t )
+    {
+        auto parser = createParser( opts.parserType );
+        KSymWriter writer;
+
+        parser->setThreadPool( &pool );
+        writer.setThreadPool( &pool );
+
+        for( size_t i; ( i = next++ ) < nFiles; )
         {
-            verb.out() << "Program entry point at " << parser->entryPoint()
-                       << "\n";
+            std::ostringstream out;
+            std::ostringstream err;
+
+            verb.redirect( &out, &err );
+            statuses[ i ] = convert( *parser, writer, opts.files[ i ],
+                                     fileOpts );
+            verb.redirect( nullptr, nullptr );
+
+            parser->close();
+            writer.close();
+
+            // print messages of a file at once
+            std::lock_guard< std::mutex > lock( outMutex );
 
-            writer.setEntryPoint( parser->entryPoint());
+            verb.out() << out.str();
+            verb.err() << err.str();
         }
+    });
+
+    return showSummary( opts.files, statuses );
+}
+
+/**
+ * Print statistics
+ *
+ * @param[in] fileName  File to write statistics to. Empty for stdout
+ * @return              true if success, otherwise false
+ */
+static bool writeStats( const std::string& fileName )
+{
+    if( fileName.empty())
+    {
+        KStats::instance().print( verb.out());
+
+        return true;
+    }
+
+    std::ofstream ofs( fileName );
+
+    KStats::instance().print( ofs );
+
+    return static_cast< bool >( ofs.flush());
+}
+
+/**
+ * Parse arguments
+ *
+ * @param[in]  args  Arguments without the program name
+ * @param[out] opts  Options
+ * @return           true if success, otherwise false
+ */
+static bool parseArgs( const std::vector< std::string >& args, Options& opts )
+{
+    for( size_t i = 0; i < args.size(); i++ )
+    {
+        const auto& arg = args[ i ];
+
+        if( arg.compare("-i") == 0 )
+            opts.parserType = KMapParserType::Ibm;
+        else if( arg.compare("-w") == 0 )
+            opts.parserType = KMapParserType::Watcom;
+        else if( arg.compare("-a") == 0 )
+            opts.omitAlphaSort = true;
+        else if( arg.compare("-l") == 0 )
+            opts.level = KVerbose::Level::Info;
+        else if( arg.compare("-ll") == 0 )
+            opts.level = KVerbose::Level::Debug;
+        else if( arg.compare("-n") == 0 )
+            opts.lineNumbers = true;
+        else if( arg.compare("-r") == 0 )
+            opts.reportLimits = true;
+        else if( arg.compare("-x") == 0 )
+            opts.writeIndex = true;
+        else if( arg.compare( 0, 2, "-j") == 0 )
+        {
+            std::string n( arg.substr( 2 ));
+
+            if( n.empty() && i + 1 < args.size() )
+                n = args[ ++i ];
+
+            char *end;
+            opts.jobs = std::strtoul( n.c_str(), &end, 10 );
+            if( n.empty() || *end != '\0' || opts.jobs == 0 )
+            {
+                verb.err() << "Invalid number of jobs: " << n << "\n";
+                showUsage();
+
+                return false;
+            }
+        }
+        else if( arg.compare("-c") == 0 )
+            opts.cache = true;
+        else if( arg.compare( 0, 2, "-C") == 0 )
+        {
+            opts.cacheDir = arg.substr( 2 );
+
+            if( opts.cacheDir.empty() && i + 1 < args.size() )
+                opts.cacheDir = args[ ++i ];
+
+            if( opts.cacheDir.empty())
+            {
+                verb.err() << "Missing cache directory!!!\n";
+                showUsage();
+
+                return false;
+            }
+
+            opts.cache = true;
+        }
+        else if( arg.compare("--stats") == 0 )
+            opts.stats = true;
+        else if( arg.compare( 0, 8, "--stats=") == 0 )
+        {
+            opts.stats = true;
+            opts.statsFile = arg.substr( 8 );
+        }
+        else if( arg.compare( 0, 9, "--memory=") == 0 )
+        {
+            std::string n( arg.substr( 9 ));
+
+            char *end;
+            size_t mb = std::strtoul( n.c_str(), &end, 10 );
+            if( n.empty() || *end != '\0' || mb == 0 )
+            {
+                verb.err() << "Invalid memory budget: " << n << "\n";
+                showUsage();
+
+                return false;
+            }
+
+            opts.memory = mb * 1024 * 1024;
+        }
+        else if( arg.compare( 0, 8, "--serve=") == 0 )
+        {
+            opts.serve = arg.substr( 8 );
+
+            if( opts.serve.empty())
+            {
+                verb.err() << "Missing socket path!!!\n";
+                showUsage();
+
+                return false;
+            }
+        }
+        else if( arg[ 0 ] == '@')
+        {
+            if( !readResponseFile( arg.substr( 1 ), opts.files ))
+            {
+                verb.err() << "Cannot read " << arg.substr( 1 ) << "!!!\n";
+
+                return false;
+            }
+        }
+        else
+            opts.files.push_back( arg );
+    }
+
+    if( opts.files.empty() && opts.serve.empty())
+    {
+        verb.err() << "Missing .MAP file name!!!\n";
+        showUsage();
+
+        return false;
+    }
+
+    return true;
+}
+
+/// version of the protocol between a server and its clients
+static constexpr std::string_view ProtocolVersion = "kmapsym/1";
+
+/// tag of messages to stdout in a reply
+static constexpr std::string_view OutTag = "out";
+
+/// tag of messages to stderr in a reply
+static constexpr std::string_view ErrTag = "err";
+
+/// time to wait for a connection before checking a signal to stop
+static constexpr int AcceptTimeoutMs = 200;
+
+/// time for a client to send its request
+static constexpr int RequestTimeoutMs = 5000;
+
+/// max. size of a request
+static constexpr size_t MaxRequestSize = 1024 * 1024;
+
+/// max. # of requests to read at once
+static constexpr size_t MaxReadingRequests = 64;
+
+/// set by a signal to stop the server
+static volatile std::sig_atomic_t stopServer = 0;
+
+/**
+ * Signal handler to stop the server
+ */
+static void stopServing( int )
+{
+    stopServer = 1;
+}
+
+/**
+ * Messages of a request as pairs of a stream tag and text in order of
+ * printing
+ */
+using Messages = std::vector< std::pair< std::string_view, std::string >>;
+
+/**
+ * Stream buffer keeping messages to a stream in order with the ones to the
+ * other streams
+ */
+struct MessageBuffer: std::streambuf
+{
+    Messages& messages;     ///< messages of all the streams
+    std::string_view tag;   ///< tag of the stream
+
+    /**
+     * Constructor
+     *
+     * @param[in] m Messages of all the streams
+     * @param[in] t Tag of the stream
+     */
+    MessageBuffer( Messages& m, std::string_view t )
+        : messages( m ), tag( t ) {}
+
+    /**
+     * Keep a character
+     */
+    int overflow( int c ) override
+    {
+        if( traits_type::eq_int_type( c, traits_type::eof()))
+            return traits_type::not_eof( c );
+
+        char ch = traits_type::to_char_type( c );
+
+        xsputn( &ch, 1 );
+
+        return c;
+    }
+
+    /**
+     * Keep characters
+     */
+    std::streamsize xsputn( const char *s, std::streamsize n ) override
+    {
+        if( messages.empty() || messages.back().first != tag )
+            messages.emplace_back( tag, std::string());
+
+        messages.back().second.append( s, n );
+
+        return n;
+    }
+};
+
+/**
+ * Server worker keeping its parsers and writer warm across requests
+ */
+struct ServerWorker
+{
+    KThreadPool& pool;                      ///< thread pool of conversions
+    std::unique_ptr< KMapParser > ibm;      ///< IBM .MAP file parser
+    std::unique_ptr< KMapParser > watcom;   ///< Watcom .MAP file parser
+    KSymWriter writer;                      ///< .SYM file writer
+
+    /**
+     * Constructor
+     *
+     * @param[in] p Thread pool of conversions
+     */
+    explicit ServerWorker( KThreadPool& p )
+        : pool( p )
+    {
+        writer.setThreadPool( &pool );
+    }
+
+    /**
+     * Get the parser of a .MAP file type
+     */
+    KMapParser& parser( KMapParserType type )
+    {
+        auto& p = type == KMapParserType::Ibm ? ibm : watcom;
+
+        if( !p )
+        {
+            p = createParser( type );
+            p->setThreadPool( &pool );
+        }
+
+        return *p;
+    }
+};
+
+/**
+ * Convert .MAP files requested to a server
+ *
+ * @param[in] opts          Options of a request
+ * @param[in] dir           Current directory of the client
+ * @param[in] worker        Worker to convert with
+ * @param[in] statsMutex    Mutex locked exclusively while recording
+ *                          statistics
+ * @return                  Exit code
+ */
+static int convertRequest( Options opts, const std::string& dir,
+                           ServerWorker& worker,
+                           std::shared_mutex& statsMutex )
+{
+    opts.dir = dir;
+
+    if( !opts.cacheDir.empty())
+        opts.cacheDir = resolvePath( dir, opts.cacheDir );
+
+    if( !opts.statsFile.empty())
+        opts.statsFile = resolvePath( dir, opts.statsFile );
+
+    // statistics are process-wide. so no other request runs while recording
+    std::shared_lock< std::shared_mutex > shared( statsMutex,
+                                                  std::defer_lock );
+    std::unique_lock< std::shared_mutex > exclusive( statsMutex,
+                                                     std::defer_lock );
+
+    if( opts.stats )
+    {
+        exclusive.lock();
+
+        if( auto heap = KStats::heapCounters())
+            heap->peakBytes = heap->curBytes.load();
+
+        KStats::instance().reset();
+    }
+    else
+        shared.lock();
+
+    auto& parser = worker.parser( opts.parserType );
+    std::vector< Status > statuses;
+
+    for( const auto& file: opts.files )
+    {
+        statuses.push_back( convert( parser, worker.writer, file, opts ));
+
+        parser.close();
+        worker.writer.close();
+    }
+
+    int rc;
+
+    if( statuses.size() > 1 )
+        rc = showSummary( opts.files, statuses ) ? 0 : 1;
+    else
+    {
+        // keep the exit code of the single file mode
+        rc = statuses[ 0 ] == Status::OpenFailed ? 1 : 0;
+    }
+
+    if( opts.stats )
+    {
+        if( !writeStats( opts.statsFile ))
+        {
+            verb.err() << "Cannot write " << opts.statsFile << "!!!\n";
+
+            rc = 1;
+        }
+
+        KStats::instance().disable();
+    }
+
+    return rc;
+}
+
+/**
+ * Handle a request to a server
+ *
+ * A request consists of the protocol version, the current directory of
+ * the client and the arguments. A reply consists of the exit code, and
+ * pairs of a stream tag and messages to the stream.
+ *
+ * @param[in] msg           Request message
+ * @param[in] worker        Worker to convert with
+ * @param[in] statsMutex    Mutex locked exclusively while recording
+ *                          statistics
+ * @return                  Reply message
+ */
+static std::string handleRequest( std::string_view msg, ServerWorker& worker,
+                                  std::shared_mutex& statsMutex )
+{
+    Messages messages;
+    MessageBuffer outBuf( messages, OutTag );
+    MessageBuffer errBuf( messages, ErrTag );
+    std::ostream out( &outBuf );
+    std::ostream err( &errBuf );
+    std::string_view field;
+    std::string dir;
+    std::vector< std::string > args;
+    bool valid = KLocalSocket::getField( msg, field )
+                 && field == ProtocolVersion
+                 && KLocalSocket::getField( msg, field );
+
+    if( valid )
+    {
+        dir = field;
+
+        while( KLocalSocket::getField( msg, field ))
+            args.emplace_back( field );
+
+        valid = msg.empty();
+    }
+
+    verb.redirect( &out, &err );
+
+    Options opts;
+    int rc = 1;
+
+    if( !valid )
+        verb.err() << "Invalid request!!!\n";
+    else
+    {
+        // response files are relative to the client, too
+        for( auto& arg: args )
+        {
+            if( arg[ 0 ] == '@')
+                arg = "@" + resolvePath( dir, arg.substr( 1 ));
+        }
+
+        if( parseArgs( args, opts ))
+        {
+            if( !opts.serve.empty())
+                verb.err() << "Cannot serve in a request!!!\n";
+            else
+            {
+                verb.threadLevel( opts.level );
+
+                rc = convertRequest( opts, dir, worker, statsMutex );
+
+                verb.threadLevel( std::nullopt );
+            }
+        }
+    }
+
+    verb.redirect( nullptr, nullptr );
+
+    std::string reply;
+
+    KLocalSocket::putField( reply, std::to_string( rc ));
+
+    for( const auto& [ tag, text ]: messages )
+    {
+        KLocalSocket::putField( reply, tag );
+        KLocalSocket::putField( reply, text );
+    }
+
+    return reply;
+}
+
+/**
+ * Accept connections and read requests from them together until a signal
+ * to stop, so that a slow client does not block the others
+ *
+ * @param[in] listener  Listening socket
+ * @param[in] queue     Function called with a client and its request
+ * @remark              Drops a client too slow or sending a too large
+ *                      request
+ */
+template< typename F >
+static void acceptRequests( KLocalSocket& listener, F queue )
+{
+    // client reading its request
+    struct Reading
+    {
+        std::unique_ptr< KLocalSocket > peer;   ///< client
+        std::string msg;                        ///< request read so far
+        std::chrono::steady_clock::time_point deadline; ///< time to give up
+    };
+
+    std::vector< Reading > reading;
+    std::vector< KLocalSocket * > sockets;
+    std::vector< bool > ready;
+
+    while( !stopServer )
+    {
+        sockets.clear();
+
+        for( const auto& r: reading )
+            sockets.push_back( r.peer.get());
+
+        // accept no more while reading too many requests
+        bool accepting = reading.size() < MaxReadingRequests;
+        if( accepting )
+            sockets.push_back( &listener );
+
+        KLocalSocket::waitAny( sockets, AcceptTimeoutMs, ready );
+
+        auto now = std::chrono::steady_clock::now();
+        size_t nKept = 0;
+
+        for( size_t i = 0; i < reading.size(); i++ )
+        {
+            auto& r = reading[ i ];
+            bool end = false;
+
+            if( ready[ i ] ? !r.peer->receive( r.msg, MaxRequestSize, end )
+                           : now >= r.deadline )
+                continue;
+
+            if( end )
+                queue( std::move( r.peer ), std::move( r.msg ));
+            else if( nKept++ != i )
+                reading[ nKept - 1 ] = std::move( r );
+        }
+
+        reading.resize( nKept );
+
+        if( accepting && ready.back())
+        {
+            auto peer = std::make_unique< KLocalSocket >();
+
+            if( listener.accept( *peer ))
+                reading.push_back({ std::move( peer ), {},
+                                    now + std::chrono::milliseconds(
+                                              RequestTimeoutMs )});
+        }
+    }
+}
+
+/**
+ * Serve conversions requested on a local socket until interrupted
+ *
+ * @param[in] opts  Options
+ * @return          true if success, otherwise false
+ */
+static bool serve( const Options& opts )
+{
+    KLocalSocket listener;
+
+    if( !listener.listen( opts.serve ))
+    {
+        verb.err() << "Cannot listen on " << opts.serve << "!!!\n";
+
+        return false;
+    }
+
+    std::signal( SIGINT, stopServing );
+    std::signal( SIGTERM, stopServing );
+#ifdef SIGPIPE
+    // a client may go away before its reply
+    std::signal( SIGPIPE, SIG_IGN );
+#endif
+
+    KThreadPool pool( opts.jobs );
+    size_t nWorkers = pool.size();
+
+    // a thread accepts connections and reads requests, and the others
+    // handle them
+    KThreadPool serverPool( nWorkers + 1 );
+    std::deque< std::pair< std::unique_ptr< KLocalSocket >, std::string >>
+        pending;
+    bool done = false;
+    std::mutex pendingMutex;
+    std::condition_variable pendingCv;
+    std::shared_mutex statsMutex;
+
+    verb.info() << "Serving on " << opts.serve << " with " << nWorkers
+                << " worker" << ( nWorkers > 1 ? "s" : "") << "\n";
+
+    serverPool.run( nWorkers + 1, [ & ]( size_t i )
+    {
+        if( i == 0 )
+        {
+            acceptRequests( listener, [ & ]( auto peer, std::string msg )
+            {
+                std::lock_guard< std::mutex > lock( pendingMutex );
+
+                pending.emplace_back( std::move( peer ), std::move( msg ));
+                pendingCv.notify_one();
+            });
+
+            std::lock_guard< std::mutex > lock( pendingMutex );
+
+            done = true;
+            pendingCv.notify_all();
+
+            return;
+        }
+
+        ServerWorker worker( pool );
+
+        for(;;)
+        {
+            std::unique_ptr< KLocalSocket > peer;
+            std::string msg;
+
+            {
+                std::unique_lock< std::mutex > lock( pendingMutex );
+
+                pendingCv.wait( lock, [ & ] {
+                    return done || !pending.empty(); });
+
+                if( pending.empty())
+                    return;
+
+                peer = std::move( pending.front().first );
+                msg = std::move( pending.front().second );
+                pending.pop_front();
+            }
+
+            peer->send( handleRequest( msg, worker, statsMutex ));
+        }
+    });
+
+    verb.info() << "Stopped serving on " << opts.serve << "\n";
+
+    return true;
+}
+
+/**
+ * Request a conversion to a server, and print the reply
+ *
+ * @param[in] path  Socket path of the server
+ * @param[in] args  Arguments without the program name and the socket path
+ * @return          Exit code
+ */
+static int request( const std::string& path,
+                    const std::vector< std::string >& args )
+{
+    KLocalSocket server;
+
+    if( !server.connect( path ))
+    {
+        verb.err() << "Cannot connect to " << path << "!!!\n";
+
+        return 1;
+    }
+
+    std::error_code ec;
+    std::string msg;
+
+    KLocalSocket::putField( msg, ProtocolVersion );
+    KLocalSocket::putField( msg,
+                            std::filesystem::current_path( ec ).string());
+
+    for( const auto& arg: args )
+        KLocalSocket::putField( msg, arg );
+
+    std::string reply;
+
+    if( !server.send( msg ) || !server.endSend()
+        || !server.receiveAll( reply ))
+    {
+        verb.err() << "Cannot communicate with " << path << "!!!\n";
+
+        return 1;
+    }
+
+    std::string_view rest( reply );
+    std::string_view rc;
+    std::string_view tag;
+    std::string_view text;
+
+    if( !KLocalSocket::getField( rest, rc ))
+    {
+        verb.err() << "Invalid reply from " << path << "!!!\n";
+
+        return 1;
+    }
+
+    // print the messages in order
+    while( KLocalSocket::getField( rest, tag )
+           && KLocalSocket::getField( rest, text ))
+        ( tag == ErrTag ? verb.err() : verb.out()) << text;
+
+    return std::atoi( std::string( rc ).c_str());
+}
+
+int main( int argc, char *argv[])
+{
+    Options opts;
+
+    // let std::cout buffer by itself for long listings. std::cerr still
+    // flushes it first
+    std::ios::sync_with_stdio( false );
+
+    if( argc < 2 )
+    {
+        showUsage();
+
+        return 1;
+    }
+
+    std::vector< std::string > args( argv + 1, argv + argc );
+
+    for( auto it = args.begin(); it != args.end(); ++it )
+    {
+        if( it->compare( 0, 9, "--server=") == 0 )
+        {
+            std::string path( it->substr( 9 ));
+
+            args.erase( it );
+
+            return request( path, args );
+        }
+    }
+
+    if( !parseArgs( args, opts ))
+        return 1;
+
+    verb.level( opts.level );
+
+    if( !opts.serve.empty())
+        return serve( opts ) ? 0 : 1;
+
+    if( opts.stats )
+        KStats::instance().enable();
+
+    KThreadPool pool( opts.jobs );
+    int rc;
+
+    if( opts.files.size() > 1 )
+        rc = convertAll( opts, pool ) ? 0 : 1;
+    else
+    {
+        auto parser = createParser( opts.parserType );
+        KSymWriter writer;
+
+        parser->setThreadPool( &pool );
+        writer.setThreadPool( &pool );
+
+        // keep the exit code of the single file mode
+        rc = convert( *parser, writer, opts.files[ 0 ], opts )
+                == Status::OpenFailed ? 1 : 0;
+    }
+
+    if( opts.stats && !writeStats( opts.statsFile ))
+    {
+        verb.err() << "Cannot write " << opts.statsFile << "!!!\n";
 
-        writer.write();
+        rc = 1;
     }
 
-    return 0;
+    return rc;
 }
@@ -0,0 +1,342 @@
+/*
+ * KSpillSorter
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "kspillsorter.h"
+
+#include "kverbose.h"
+
+#include <algorithm>
+
+#define verb KVerbose::instance()
+
+/// heap bytes to sort a public besides itself and its name
+static constexpr size_t SortCost = 64;
+
+/// min. size of the buffer of a run while merging
+static constexpr size_t MinRunBufferSize = 64 * 1024;
+
+KSpillSorter::KSpillSorter( size_t budget )
+    : _budget( budget )
+    , _coll( KCollation::Fold::Upper )
+{
+}
+
+KSpillSorter::~KSpillSorter()
+{
+    closeRuns( 0, _runs.size());
+}
+
+bool KSpillSorter::add( const KMapParser::Public& pub )
+{
+    // reserve at once not to double the memory when growing
+    if( _publics.capacity() == 0 )
+        _publics.reserve( _budget / ( sizeof( pub ) + SortCost ) + 1 );
+
+    _publics.push_back( pub );
+    _bytes += sizeof( pub ) + SortCost + pub.name.size();
+    _seq++;
+
+    if( _bytes >= _budget )
+        return spill();
+
+    return true;
+}
+
+bool KSpillSorter::finish()
+{
+    std::vector< Record > records;
+
+    sortHeld( records );
+
+    // not to be added any more
+    std::vector< KMapParser::Public >().swap( _publics );
+
+    // merge runs until they and the publics held can be merged at once
+    size_t fanIn = std::max< size_t >( 2, _budget / MinRunBufferSize - 1 );
+    size_t maxRuns = records.empty() ? fanIn : fanIn - 1;
+
+    while( _runs.size() > maxRuns )
+    {
+        if( !mergeRuns( 0, std::min( fanIn, _runs.size())))
+            return false;
+    }
+
+    if( !records.empty())
+        _runs.push_back({ nullptr, 0, std::move( records ), 0 });
+
+    startMerge( 0, _runs.size());
+
+    return !_failed;
+}
+
+bool KSpillSorter::next( KMapParser::Public& pub )
+{
+    Record rec;
+
+    if( !nextRecord( rec ))
+        return false;
+
+    pub.addr = rec.addr;
+    pub.name = std::string_view( rec.name, rec.len );
+
+    return true;
+}
+
+void KSpillSorter::sortHeld( std::vector< Record >& records )
+{
+    records.clear();
+
+    if( _publics.empty())
+        return;
+
+    std::vector< uint32_t > byName( _publics.size());
+    std::vector< uint32_t > byValue;
+
+    for( uint32_t i = 0; i < byName.size(); i++ )
+        byName[ i ] = i;
+
+    KMapParser::sortPublics( _publics, byName, byValue );
+
+    // publics held were added last
+    uint32_t base = _seq - static_cast< uint32_t >( _publics.size());
+
+    records.reserve( byValue.size());
+
+    for( auto i: byValue )
+    {
+        const auto& pub = _publics[ i ];
+
+        records.push_back({ pub.addr, pub.name.data(),
+                            static_cast< uint32_t >( pub.name.size()),
+                            base + i });
+    }
+
+    _publics.clear();
+    _bytes = 0;
+}
+
+bool KSpillSorter::spill()
+{
+    std::vector< Record > records;
+
+    sortHeld( records );
+
+    if( records.empty())
+        return true;
+
+    auto fp = std::tmpfile();
+    if( !fp )
+    {
+        verb.err() << "Cannot create a temporary file!!!\n";
+
+        _failed = true;
+
+        return false;
+    }
+
+    if( !writeRecords( fp, records ))
+    {
+        std::fclose( fp );
+
+        return false;
+    }
+
+    _runs.push_back({ fp, records.size(), {}, 0 });
+
+    return true;
+}
+
+bool KSpillSorter::mergeRuns( size_t first, size_t count )
+{
+    auto fp = std::tmpfile();
+    if( !fp )
+    {
+        verb.err() << "Cannot create a temporary file!!!\n";
+
+        _failed = true;
+
+        return false;
+    }
+
+    startMerge( first, count );
+
+    std::vector< Record > records;
+    size_t total = 0;
+    Record rec;
+
+    records.reserve( _bufRecords );
+
+    while( nextRecord( rec ))
+    {
+        records.push_back( rec );
+
+        if( records.size() == _bufRecords )
+        {
+            if( !writeRecords( fp, records ))
+                break;
+
+            total += records.size();
+            records.clear();
+        }
+    }
+
+    if( !_failed && writeRecords( fp, records ))
+        total += records.size();
+
+    if( _failed )
+    {
+        std::fclose( fp );
+
+        return false;
+    }
+
+    closeRuns( first, count );
+
+    _runs.erase( _runs.begin() + first, _runs.begin() + first + count );
+    _runs.push_back({ fp, total, {}, 0 });
+
+    return true;
+}
+
+void KSpillSorter::startMerge( size_t first, size_t count )
+{
+    // share the budget with the output buffer, too
+    _bufRecords = std::max( _budget / ( count + 1 ), MinRunBufferSize )
+                  / sizeof( Record );
+
+    _heap.clear();
+
+    for( size_t i = first; i < first + count; i++ )
+    {
+        auto& run = _runs[ i ];
+
+        if( run.fp )
+        {
+            // seek to the start of the run for reading
+            if( std::fseek( run.fp, 0, SEEK_SET ) != 0 )
+            {
+                verb.err() << "Cannot read a temporary file!!!\n";
+
+                _failed = true;
+
+                return;
+            }
+
+            run.buf.clear();
+            run.pos = 0;
+        }
+
+        if( run.pos < run.buf.size() || fill( run ))
+            _heap.push_back( i );
+    }
+
+    std::make_heap( _heap.begin(), _heap.end(),
+                    [ this ]( size_t a, size_t b ) { return after( a, b ); });
+}
+
+bool KSpillSorter::nextRecord( Record& rec )
+{
+    if( _failed || _heap.empty())
+        return false;
+
+    auto cmp = [ this ]( size_t a, size_t b ) { return after( a, b ); };
+
+    std::pop_heap( _heap.begin(), _heap.end(), cmp );
+
+    auto& run = _runs[ _heap.back()];
+
+    rec = run.buf[ run.pos++ ];
+
+    if( run.pos < run.buf.size() || fill( run ))
+        std::push_heap( _heap.begin(), _heap.end(), cmp );
+    else
+        _heap.pop_back();
+
+    return !_failed;
+}
+
+bool KSpillSorter::fill( Run& run )
+{
+    if( !run.fp || run.count == 0 )
+    {
+        // release the memory of the run
+        std::vector< Record >().swap( run.buf );
+        run.pos = 0;
+
+        return false;
+    }
+
+    size_t n = std::min( run.count, _bufRecords );
+
+    run.buf.resize( n );
+    run.pos = 0;
+
+    if( std::fread( run.buf.data(), sizeof( Record ), n, run.fp ) != n )
+    {
+        verb.err() << "Cannot read a temporary file!!!\n";
+
+        _failed = true;
+
+        return false;
+    }
+
+    run.count -= n;
+
+    return true;
+}
+
+bool KSpillSorter::writeRecords( std::FILE *fp,
+                                 const std::vector< Record >& records )
+{
+    if( std::fwrite( records.data(), sizeof( Record ), records.size(), fp )
+            != records.size())
+    {
+        verb.err() << "Cannot write a temporary file!!!\n";
+
+        _failed = true;
+
+        return false;
+    }
+
+    return true;
+}
+
+bool KSpillSorter::after( size_t a, size_t b ) const
+{
+    const auto& ra = _runs[ a ].buf[ _runs[ a ].pos ];
+    const auto& rb = _runs[ b ].buf[ _runs[ b ].pos ];
+
+    if( ra.addr != rb.addr )
+        return ra.addr > rb.addr;
+
+    int cmp = _coll.compare( std::string_view( ra.name, ra.len ),
+                             std::string_view( rb.name, rb.len ));
+    if( cmp != 0 )
+        return cmp > 0;
+
+    return ra.seq > rb.seq;
+}
+
+void KSpillSorter::closeRuns( size_t first, size_t count )
+{
+    for( size_t i = first; i < first + count; i++ )
+    {
+        if( _runs[ i ].fp )
+            std::fclose( _runs[ i ].fp );
+
+        _runs[ i ].fp = nullptr;
+    }
+}
@@ -0,0 +1,204 @@
+/*
+ * KSpillSorter
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KSPILLSORTER_H
+#define KMAPSYM_KSPILLSORTER_H
+
+#include "kmapparser.h"
+#include "kcollation.h"
+
+#include <cstdio>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Sorter of public symbols by value within a memory budget
+ *
+ * Publics are sorted in memory until the budget is used up, and then moved
+ * to a sorted run in a temporary file. The runs are merged at the end. The
+ * order is the same as KMapParser::sortPublics().
+ *
+ * Only the addresses and the names of publics are kept, and the names are
+ * referred to as they are. So the names should be valid until the sorter
+ * is destroyed.
+ */
+class KSpillSorter
+{
+public:
+    /**
+     * Constructor
+     *
+     * @param[in] budget    Max. bytes of heap memory to use
+     */
+    explicit KSpillSorter( size_t budget );
+
+    /**
+     * Destructor
+     */
+    ~KSpillSorter();
+
+    /**
+     * Copy constructor
+     */
+    KSpillSorter( const KSpillSorter& ) = delete;
+
+    /**
+     * operator=
+     */
+    KSpillSorter& operator=( const KSpillSorter& ) = delete;
+
+    /**
+     * Add a public symbol
+     *
+     * @param[in] pub   Public symbol to add
+     * @return          true if success, otherwise false
+     */
+    bool add( const KMapParser::Public& pub );
+
+    /**
+     * Finish adding, and prepare to get public symbols in order
+     *
+     * @return true if success, otherwise false
+     */
+    bool finish();
+
+    /**
+     * Get the next public symbol in order of value
+     *
+     * @param[out] pub  Next public symbol
+     * @return          true if @p pub is got, false at the end or on error
+     * @remark          Call failed() to tell an error from the end
+     */
+    bool next( KMapParser::Public& pub );
+
+    /**
+     * Check if an error occurred
+     */
+    bool failed() const { return _failed; }
+
+private:
+    /**
+     * Public symbol in a run
+     */
+    struct Record
+    {
+        KMapParser::Addr addr;  ///< address or value of the symbol
+        const char *name;       ///< name of the symbol
+        uint32_t len;           ///< length of the name
+        uint32_t seq;           ///< order of addition
+    };
+
+    /**
+     * Run of records sorted in a temporary file
+     */
+    struct Run
+    {
+        std::FILE *fp;          ///< temporary file. nullptr for memory
+        size_t count;           ///< # of records not read yet from fp
+        std::vector< Record > buf;  ///< records read
+        size_t pos;             ///< position of the next record in buf
+    };
+
+    size_t _budget;                             ///< memory budget in bytes
+    KCollation _coll;                           ///< collation of names
+
+    std::vector< KMapParser::Public > _publics; ///< publics not in runs yet
+    size_t _bytes = 0;                          ///< memory used by _publics
+    uint32_t _seq = 0;                          ///< # of publics added
+
+    std::vector< Run > _runs;                   ///< runs to merge
+    std::vector< size_t > _heap;                ///< runs by next record
+    size_t _bufRecords = 0;                     ///< # of records to read or
+                                                ///< write at once
+    bool _failed = false;                       ///< error occurred
+
+    /**
+     * Sort the publics held
+     *
+     * @param[out] records  Publics held in order of value
+     */
+    void sortHeld( std::vector< Record >& records );
+
+    /**
+     * Write the publics held to a run in a temporary file
+     *
+     * @return true if success, otherwise false
+     */
+    bool spill();
+
+    /**
+     * Merge runs into a run in a temporary file
+     *
+     * @param[in] first     Index of the first run to merge
+     * @param[in] count     # of runs to merge
+     * @return              true if success, otherwise false
+     * @remark              The merged runs are replaced with the new run
+     */
+    bool mergeRuns( size_t first, size_t count );
+
+    /**
+     * Start merging runs
+     *
+     * @param[in] first     Index of the first run to merge
+     * @param[in] count     # of runs to merge
+     * @remark              Memory budget is shared by the runs
+     */
+    void startMerge( size_t first, size_t count );
+
+    /**
+     * Get the next record of the runs being merged
+     *
+     * @param[out] rec  Next record
+     * @return          true if @p rec is got, false at the end or on error
+     */
+    bool nextRecord( Record& rec );
+
+    /**
+     * Read records of a run into its buffer
+     *
+     * @param[in] run   Run to read
+     * @return          true if any record is read, otherwise false
+     */
+    bool fill( Run& run );
+
+    /**
+     * Write records to a file
+     *
+     * @param[in] fp        File to write to
+     * @param[in] records   Records to write
+     * @return              true if success, otherwise false
+     */
+    bool writeRecords( std::FILE *fp, const std::vector< Record >& records );
+
+    /**
+     * Compare the next records of two runs
+     *
+     * @return true if the next record of @p a comes after the one of @p b
+     */
+    bool after( size_t a, size_t b ) const;
+
+    /**
+     * Close the files of runs
+     *
+     * @param[in] first     Index of the first run to close
+     * @param[in] count     # of runs to close
+     */
+    void closeRuns( size_t first, size_t count );
+};
+
+#endif
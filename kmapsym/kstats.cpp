@@ -0,0 +1,153 @@
+/*
+ * KStats
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "kstats.h"
+
+KStats::Timer::Timer( Phase phase )
+    : _phase( phase )
+    , _outer( nullptr )
+    , _enabled( KStats::instance().enabled())
+{
+    if( !_enabled )
+        return;
+
+    _start = Clock::now();
+
+    // pause the outer timer
+    _outer = _current;
+    if( _outer )
+        _outer->stop( _start );
+
+    _current = this;
+}
+
+KStats::Timer::~Timer()
+{
+    if( !_enabled )
+        return;
+
+    auto now = Clock::now();
+
+    stop( now );
+
+    // resume the outer timer
+    _current = _outer;
+    if( _outer )
+        _outer->_start = now;
+}
+
+void KStats::Timer::phase( Phase phase )
+{
+    if( !_enabled )
+        return;
+
+    auto now = Clock::now();
+
+    stop( now );
+
+    _phase = phase;
+    _start = now;
+}
+
+void KStats::Timer::stop( Clock::time_point now )
+{
+    auto ns = std::chrono::duration_cast< std::chrono::nanoseconds >(
+                    now - _start ).count();
+
+    KStats::instance().addTime( _phase, ns );
+}
+
+void KStats::enable()
+{
+    _start = std::chrono::steady_clock::now();
+    _enabled = true;
+}
+
+void KStats::reset()
+{
+    for( auto& t: _times )
+        t = 0;
+
+    for( auto& c: _counters )
+        c = 0;
+
+    enable();
+}
+
+void KStats::print( std::ostream& os ) const
+{
+    auto ms = []( uint64_t ns ) { return ns / 1e6; };
+
+    auto total = std::chrono::duration_cast< std::chrono::nanoseconds >(
+                    std::chrono::steady_clock::now() - _start ).count();
+
+    auto flags = os.flags();
+    auto precision = os.precision( 3 );
+
+    os << std::fixed
+       << "{\n"
+       << "  \"files\": " << count( Counter::Files ) << ",\n"
+       << "  \"time_ms\": {\n"
+       << "    \"open\": " << ms( time( Phase::Open )) << ",\n"
+       << "    \"parse\": " << ms( time( Phase::Parse )) << ",\n"
+       << "    \"sort\": " << ms( time( Phase::Sort )) << ",\n"
+       << "    \"layout\": " << ms( time( Phase::Layout )) << ",\n"
+       << "    \"write\": " << ms( time( Phase::Write )) << ",\n"
+       << "    \"total\": " << ms( total ) << "\n"
+       << "  },\n"
+       << "  \"bytes\": {\n"
+       << "    \"read\": " << count( Counter::BytesRead ) << ",\n"
+       << "    \"skipped\": " << count( Counter::BytesSkipped ) << ",\n"
+       << "    \"written\": " << count( Counter::BytesWritten ) << "\n"
+       << "  },\n"
+       << "  \"lines\": {\n"
+       << "    \"other\": " << count( Counter::LinesOther ) << ",\n"
+       << "    \"segments\": " << count( Counter::LinesSegments ) << ",\n"
+       << "    \"groups\": " << count( Counter::LinesGroups ) << ",\n"
+       << "    \"publics_by_name\": "
+       << count( Counter::LinesPublicsByName ) << ",\n"
+       << "    \"publics_by_value\": "
+       << count( Counter::LinesPublicsByValue ) << ",\n"
+       << "    \"imports\": " << count( Counter::LinesImports ) << ",\n"
+       << "    \"line_numbers\": "
+       << count( Counter::LinesLineNumbers ) << "\n"
+       << "  },\n"
+       << "  \"written\": {\n"
+       << "    \"segments\": " << count( Counter::Segments ) << ",\n"
+       << "    \"blocks\": " << count( Counter::Blocks ) << ",\n"
+       << "    \"constants\": " << count( Counter::Constants ) << ",\n"
+       << "    \"symbols\": " << count( Counter::Symbols ) << ",\n"
+       << "    \"dropped_symbols\": " << count( Counter::DroppedSymbols )
+       << ",\n"
+       << "    \"line_numbers\": " << count( Counter::LineNumbers ) << "\n"
+       << "  },\n";
+
+    if( _heap )
+    {
+        os << "  \"heap\": {\n"
+           << "    \"allocs\": " << _heap->allocs << ",\n"
+           << "    \"frees\": " << _heap->frees << ",\n"
+           << "    \"peak_bytes\": " << _heap->peakBytes << "\n"
+           << "  }\n";
+    }
+    else
+        os << "  \"heap\": null\n";
+
+    os << "}\n";
+
+    os.precision( precision );
+    os.flags( flags );
+}
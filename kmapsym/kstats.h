@@ -0,0 +1,273 @@
+/*
+ * KStats
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KSTATS_H
+#define KMAPSYM_KSTATS_H
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Statistics of conversions
+ *
+ * Nothing is recorded unless enabled. Values are updated atomically, so
+ * worker threads may update them, too.
+ */
+class KStats
+{
+public:
+    /**
+     * Phases of conversions
+     */
+    enum class Phase
+    {
+        Open,       ///< opening files
+        Parse,      ///< parsing .MAP files
+        Sort,       ///< sorting symbols
+        Layout,     ///< laying out .SYM files
+        Write,      ///< writing .SYM and .KSI files
+        Count       ///< # of phases
+    };
+
+    /**
+     * Counters
+     */
+    enum class Counter
+    {
+        Files,                  ///< .MAP files parsed
+        BytesRead,              ///< bytes of .MAP files
+        BytesSkipped,           ///< bytes of blocks skipped
+        BytesWritten,           ///< bytes of .SYM and .KSI files
+        LinesOther,             ///< lines outside of blocks
+        LinesSegments,          ///< lines of segments blocks
+        LinesGroups,            ///< lines of groups blocks
+        LinesPublicsByName,     ///< lines of publics by name blocks
+        LinesPublicsByValue,    ///< lines of publics by value blocks
+        LinesImports,           ///< lines of imports blocks
+        LinesLineNumbers,       ///< lines of line numbers blocks
+        Segments,               ///< segments written
+        Blocks,                 ///< blocks of segments written
+        Constants,              ///< constants written
+        Symbols,                ///< symbols written
+        DroppedSymbols,         ///< constants and symbols dropped
+        LineNumbers,            ///< line numbers written
+        Count                   ///< # of counters
+    };
+
+    /**
+     * Heap allocation counters
+     */
+    struct HeapCounters
+    {
+        std::atomic< uint64_t > allocs{ 0 };    ///< # of allocations
+        std::atomic< uint64_t > frees{ 0 };     ///< # of deallocations
+        std::atomic< uint64_t > curBytes{ 0 };  ///< bytes allocated now
+        std::atomic< uint64_t > peakBytes{ 0 }; ///< max. of curBytes
+    };
+
+    /**
+     * Timer adding the time until destroyed to a phase
+     *
+     * The time of a timer created while another one is running in the same
+     * thread is not added to the outer one. So the phases do not overlap
+     * in a thread.
+     */
+    class Timer
+    {
+    public:
+        /**
+         * Constructor
+         *
+         * @param[in] phase     Phase to add the time to
+         */
+        Timer( Phase phase );
+
+        /**
+         * Destructor
+         */
+        ~Timer();
+
+        /**
+         * Copy constructor
+         */
+        Timer( const Timer& ) = delete;
+
+        /**
+         * operator=
+         */
+        Timer& operator=( const Timer& ) = delete;
+
+        /**
+         * Add the time from now on to another phase
+         *
+         * @param[in] phase     Phase to add the time to
+         */
+        void phase( Phase phase );
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        Phase _phase;               ///< phase to add the time to
+        Timer *_outer;              ///< timer paused by this timer
+        Clock::time_point _start;   ///< start of the time not added yet
+        bool _enabled;              ///< statistics enabled when created
+
+        /// innermost timer of the current thread
+        static inline thread_local Timer *_current = nullptr;
+
+        /**
+         * Add the time up to @p now to the phase
+         */
+        void stop( Clock::time_point now );
+    };
+
+    /**
+     * Singleton instance
+     */
+    static KStats& instance()
+    {
+        static KStats stats;
+
+        return stats;
+    }
+
+    /**
+     * Copy constructor
+     */
+    KStats( const KStats& ) = delete;
+
+    /**
+     * operator=
+     */
+    KStats& operator=( const KStats& ) = delete;
+
+    /**
+     * Start recording
+     */
+    void enable();
+
+    /**
+     * Stop recording
+     */
+    void disable() { _enabled = false; }
+
+    /**
+     * Check if recording
+     */
+    bool enabled() const { return _enabled; }
+
+    /**
+     * Clear the times and the counters, and restart recording
+     */
+    void reset();
+
+    /**
+     * Add to a counter
+     *
+     * @param[in] counter   Counter
+     * @param[in] n         Value to add
+     */
+    void add( Counter counter, uint64_t n )
+    {
+        if( _enabled )
+            _counters[ static_cast< size_t >( counter )] += n;
+    }
+
+    /**
+     * Add time to a phase
+     *
+     * @param[in] phase     Phase
+     * @param[in] ns        Time in nanoseconds
+     */
+    void addTime( Phase phase, uint64_t ns )
+    {
+        if( _enabled )
+            _times[ static_cast< size_t >( phase )] += ns;
+    }
+
+    /**
+     * Get the time of a phase in nanoseconds
+     */
+    uint64_t time( Phase phase ) const
+    {
+        return _times[ static_cast< size_t >( phase )];
+    }
+
+    /**
+     * Get the value of a counter
+     */
+    uint64_t count( Counter counter ) const
+    {
+        return _counters[ static_cast< size_t >( counter )];
+    }
+
+    /**
+     * Print the statistics in JSON
+     *
+     * @param[in] os    Output stream
+     * @remark          "heap" is null unless heap allocations are counted
+     */
+    void print( std::ostream& os ) const;
+
+    /**
+     * Check if heap allocations are counted
+     *
+     * @remark Counted if linked with kcountalloc.cpp
+     */
+    static bool heapCounted() { return _heap != nullptr; }
+
+    /**
+     * Get the heap allocation counters
+     *
+     * @return Heap allocation counters, or nullptr if not counted
+     */
+    static HeapCounters *heapCounters() { return _heap; }
+
+    /**
+     * Set the heap allocation counters
+     *
+     * @param[in] heap  Heap allocation counters updated by operator new()
+     *                  and operator delete()
+     */
+    static void setHeapCounters( HeapCounters *heap ) { _heap = heap; }
+
+private:
+    bool _enabled = false;      ///< recording
+
+    /// time of phases in nanoseconds
+    std::atomic< uint64_t > _times[ static_cast< size_t >( Phase::Count )]{};
+
+    /// counters
+    std::atomic< uint64_t >
+        _counters[ static_cast< size_t >( Counter::Count )]{};
+
+    /// time when recording started
+    std::chrono::steady_clock::time_point _start;
+
+    /// heap allocation counters. nullptr if not counted
+    static inline HeapCounters *_heap = nullptr;
+
+    /**
+     * Constructor
+     */
+    KStats() = default;
+};
+
+#endif
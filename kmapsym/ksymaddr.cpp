@@ -0,0 +1,425 @@
+/*
+ * K SymAddr: annotate addresses with symbols in .SYM files
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "ksymreadercache.h"
+#include "ktokenizer.h"
+#include "kverbose.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <cctype>
+#include <cstdlib>
+
+#define verb KVerbose::instance()
+
+/**
+ * Size of input to process at once
+ */
+static constexpr size_t BatchSize = 4 * 1024 * 1024;
+
+/**
+ * Options
+ */
+struct Options
+{
+    size_t maxModules = 64;             ///< max. # of .SYM files to keep
+    std::vector< std::string > dirs;    ///< directories of .SYM files
+    std::vector< std::string > files;   ///< input files
+};
+
+/**
+ * Address query of a line
+ */
+struct Query
+{
+    uint32_t group;             ///< index of a segment group in a batch
+    uint32_t line;              ///< index of a line in a batch
+    uint32_t ofs;               ///< offset
+};
+
+/**
+ * Queries to the same segment of the same module
+ */
+struct Group
+{
+    uint32_t module;            ///< index of a module name in a batch
+    uint16_t seg;               ///< segment number
+    uint32_t start;             ///< index of the first query in order
+    uint32_t count;             ///< # of queries
+};
+
+/**
+ * Result of a query
+ */
+struct Result
+{
+    uint32_t nameOfs;           ///< offset of a symbol name in a name buffer
+    uint32_t nameLen;           ///< length of a symbol name. 0 if not found
+    uint32_t disp;              ///< displacement from the symbol
+};
+
+/**
+ * Show usage
+ */
+static void showUsage()
+{
+    verb.out() << "\
+Usage: ksymaddr [options] [file...]\n\
+Annotate lines of \"module seg:offset\" with symbols in .KSI or .SYM files\n\
+Reads stdin if no files are given\n\
+options:\n\
+    -d dir: Search .KSI and .SYM files in dir. Can be given multiple times\n\
+            (default: current directory)\n\
+    -m N: Keep up to N files open (default: 64)\n\
+";
+}
+
+/**
+ * Parse an address in the form of seg:offset in hex
+ *
+ * @param[in]  s     String to parse
+ * @param[out] seg   Segment number
+ * @param[out] ofs   Offset
+ * @return           true if success, otherwise false
+ */
+static bool parseAddr( std::string_view s, uint16_t& seg, uint32_t& ofs )
+{
+    auto end = s.data() + s.size();
+
+    auto res = std::from_chars( s.data(), end, seg, 16 );
+    if( res.ec != std::errc() || res.ptr == end || *res.ptr != ':')
+        return false;
+
+    res = std::from_chars( res.ptr + 1, end, ofs, 16 );
+
+    return res.ec == std::errc() && res.ptr == end;
+}
+
+/**
+ * Annotate a batch of lines
+ *
+ * @param[in]  lines Lines without newlines
+ * @param[in]  cache .SYM reader cache
+ * @param[out] out   Buffer to append annotated lines to
+ */
+static void annotate( const std::vector< std::string_view >& lines,
+                      KSymReaderCache& cache, std::string& out )
+{
+    KTokenizer tokenizer;
+    std::vector< Query > queries;
+
+    // modules and groups are referred to by their indexes
+    std::vector< std::string_view > modules;
+    std::unordered_map< std::string_view, uint32_t > moduleIds;
+    std::vector< Group > groups;
+    std::unordered_map< uint64_t, uint32_t > groupIds;
+
+    for( uint32_t i = 0; i < lines.size(); i++ )
+    {
+        uint16_t seg;
+        uint32_t ofs;
+
+        if( tokenizer.split( lines[ i ]) < 2
+            || !parseAddr( tokenizer[ 1 ], seg, ofs ))
+            continue;
+
+        auto module = moduleIds.emplace( tokenizer[ 0 ], modules.size());
+        if( module.second )
+            modules.push_back( tokenizer[ 0 ]);
+
+        uint32_t moduleId = module.first->second;
+
+        auto group = groupIds.emplace(
+                        static_cast< uint64_t >( moduleId ) << 16 | seg,
+                        groups.size());
+        if( group.second )
+            groups.push_back({ moduleId, seg, 0, 0 });
+
+        groups[ group.first->second ].count++;
+
+        queries.push_back({ group.first->second, i, ofs });
+    }
+
+    // gather queries of each group, so that each segment table is searched
+    // at once while it is in cache
+    uint32_t start = 0;
+
+    for( auto& group: groups )
+    {
+        group.start = start;
+        start += group.count;
+    }
+
+    std::vector< uint32_t > order( queries.size());
+    std::vector< uint32_t > next( groups.size());
+
+    for( size_t i = 0; i < groups.size(); i++ )
+        next[ i ] = groups[ i ].start;
+
+    for( uint32_t i = 0; i < queries.size(); i++ )
+        order[ next[ queries[ i ].group ]++ ] = i;
+
+    // visit modules in order, not to reopen a module closed by others
+    std::sort( groups.begin(), groups.end(),
+               []( const Group& a, const Group& b )
+    {
+        return a.module != b.module ? a.module < b.module : a.seg < b.seg;
+    });
+
+    std::vector< Result > results( lines.size(), Result{ 0, 0, 0 });
+
+    // names are copied, since a module may be closed by a later module
+    std::string names;
+    KSymReaderCache::Module *mod = nullptr;
+
+    for( size_t g = 0; g < groups.size(); g++ )
+    {
+        const auto& group = groups[ g ];
+
+        if( g == 0 || group.module != groups[ g - 1 ].module )
+            mod = &cache.get( modules[ group.module ]);
+
+        if( mod->index )
+        {
+            // .KSI file is searched as it is
+            for( uint32_t i = group.start; i < group.start + group.count;
+                 i++ )
+            {
+                const auto& q = queries[ order[ i ]];
+
+                KSymIndexReader::Symbol sym;
+                uint32_t disp;
+
+                if( !mod->index->lookup(
+                        static_cast< uint64_t >( group.seg ) << 32 | q.ofs,
+                        sym, disp ))
+                    continue;
+
+                results[ q.line ] = { static_cast< uint32_t >( names.size()),
+                                      static_cast< uint32_t >(
+                                          sym.name.size()),
+                                      disp };
+                names += sym.name;
+            }
+
+            continue;
+        }
+
+        auto table = KSymReaderCache::segment( *mod, group.seg );
+        if( !table )
+            continue;
+
+        const auto& addrs = table->addrs;
+
+        for( uint32_t i = group.start; i < group.start + group.count; i++ )
+        {
+            const auto& q = queries[ order[ i ]];
+
+            size_t pos = std::upper_bound( addrs.begin(), addrs.end(), q.ofs )
+                         - addrs.begin();
+
+            // no symbols at or before the offset
+            if( pos == 0 )
+                continue;
+
+            auto sym = table->symbol( pos - 1 );
+
+            results[ q.line ] = { static_cast< uint32_t >( names.size()),
+                                  static_cast< uint32_t >( sym.name.size()),
+                                  q.ofs - sym.addr };
+            names += sym.name;
+        }
+    }
+
+    char hex[ 16 ];
+
+    for( size_t i = 0; i < lines.size(); i++ )
+    {
+        out += lines[ i ];
+
+        const auto& res = results[ i ];
+
+        if( res.nameLen > 0 )
+        {
+            out += ' ';
+            out.append( names, res.nameOfs, res.nameLen );
+
+            if( res.disp != 0 )
+            {
+                auto end = std::to_chars( hex, hex + sizeof( hex ),
+                                          res.disp, 16 ).ptr;
+
+                out += "+0x";
+                for( auto p = hex; p < end; p++ )
+                    out += static_cast< char >( std::toupper( *p ));
+            }
+        }
+
+        out += '\n';
+    }
+}
+
+/**
+ * Annotate a stream
+ *
+ * @param[in] is    Input stream
+ * @param[in] cache .SYM reader cache
+ * @param[in] os    Output stream
+ */
+static void annotateStream( std::istream& is, KSymReaderCache& cache,
+                            std::ostream& os )
+{
+    std::vector< char > buf( BatchSize );
+    std::vector< std::string_view > lines;
+    std::string out;
+    size_t len = 0;
+    bool eof = false;
+
+    while( !eof )
+    {
+        len += is.rdbuf()->sgetn( buf.data() + len, buf.size() - len );
+        eof = len < buf.size();
+
+        std::string_view data( buf.data(), len );
+
+        // process complete lines only, unless at the end
+        size_t end = eof ? len : data.rfind('\n') + 1;
+
+        if( end == 0 )
+        {
+            if( eof )
+                break;
+
+            // a line longer than the buffer
+            buf.resize( buf.size() * 2 );
+
+            continue;
+        }
+
+        lines.clear();
+
+        for( auto rest = data.substr( 0, end ); !rest.empty(); )
+        {
+            auto nl = rest.find('\n');
+            auto line = rest.substr( 0, nl );
+
+            if( !line.empty() && line.back() == '\r')
+                line.remove_suffix( 1 );
+
+            lines.push_back( line );
+
+            rest.remove_prefix( nl == std::string_view::npos ?
+                                rest.size() : nl + 1 );
+        }
+
+        out.clear();
+        annotate( lines, cache, out );
+        os.write( out.data(), out.size());
+
+        // keep the incomplete line
+        std::copy( buf.data() + end, buf.data() + len, buf.data());
+        len -= end;
+    }
+}
+
+int main( int argc, char *argv[])
+{
+    Options opts;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        std::string arg( argv[ i ]);
+
+        if( arg.compare( 0, 2, "-d") == 0 || arg.compare( 0, 2, "-m") == 0 )
+        {
+            std::string val( arg.substr( 2 ));
+
+            if( val.empty() && i + 1 < argc )
+                val = argv[ ++i ];
+
+            if( val.empty())
+            {
+                verb.err() << "Missing value of " << arg << "!!!\n";
+                showUsage();
+
+                return 1;
+            }
+
+            if( arg[ 1 ] == 'd')
+                opts.dirs.push_back( val );
+            else
+            {
+                char *end;
+
+                opts.maxModules = std::strtoul( val.c_str(), &end, 10 );
+                if( *end != '\0' || opts.maxModules == 0 )
+                {
+                    verb.err() << "Invalid number of files: " << val << "\n";
+                    showUsage();
+
+                    return 1;
+                }
+            }
+        }
+        else if( arg.compare("-h") == 0 || arg.compare("--help") == 0 )
+        {
+            showUsage();
+
+            return 0;
+        }
+        else
+            opts.files.push_back( arg );
+    }
+
+    std::ios::sync_with_stdio( false );
+
+    KSymReaderCache cache( opts.maxModules, opts.dirs );
+
+    if( opts.files.empty())
+        opts.files.push_back("-");
+
+    int rc = 0;
+
+    for( const auto& file: opts.files )
+    {
+        if( file == "-")
+        {
+            annotateStream( std::cin, cache, std::cout );
+
+            continue;
+        }
+
+        std::ifstream ifs( file, std::ios::binary );
+        if( !ifs )
+        {
+            verb.err() << "Cannot open " << file << "!!!\n";
+            rc = 1;
+
+            continue;
+        }
+
+        annotateStream( ifs, cache, std::cout );
+    }
+
+    return rc;
+}
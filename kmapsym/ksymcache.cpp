@@ -0,0 +1,144 @@
+/*
+ * KSymCache
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "ksymcache.h"
+
+#include "khash.h"
+#include "ksymformat.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <iomanip>
+
+namespace fs = std::filesystem;
+
+/**
+ * Salt of cache keys. Hashed with SymOutputRevision not to hit outdated
+ * .SYM files
+ */
+static constexpr std::string_view KeySalt = "K MapSym cache";
+
+/**
+ * Format a cache key in hex
+ */
+static std::string keyString( uint64_t key )
+{
+    std::ostringstream oss;
+
+    oss << std::hex << std::uppercase << std::setw( 16 ) << std::setfill('0')
+        << key;
+
+    return oss.str();
+}
+
+KSymCache::KSymCache( std::string_view cacheDir )
+    : _cacheDir( cacheDir )
+{
+}
+
+uint64_t KSymCache::key( std::string_view mapData, std::string_view options )
+{
+    uint64_t seed = KHash::xxh64( options,
+                                 KHash::xxh64( KeySalt, SymOutputRevision ));
+
+    return KHash::xxh64( mapData, seed );
+}
+
+bool KSymCache::lookup( std::string_view symFileName, uint64_t key ) const
+{
+    auto stamp = stampName( symFileName );
+    std::error_code ec;
+
+    std::ifstream ifs( stamp );
+    std::string stampKey;
+    uintmax_t stampSize = 0;
+
+    if( ifs >> stampKey >> stampSize && stampKey == keyString( key )
+        && fs::file_size( symFileName, ec ) == stampSize && !ec )
+        return true;
+
+    ifs.close();
+
+    // the stamp is stale. remove it before the .SYM file is overwritten
+    fs::remove( stamp, ec );
+
+    if( _cacheDir.empty())
+        return false;
+
+    auto cached = cachedName( key );
+
+    if( !fs::exists( cached, ec )
+        || !fs::copy_file( cached, symFileName,
+                           fs::copy_options::overwrite_existing, ec ))
+        return false;
+
+    // stamp the copied one, too
+    store( symFileName, key );
+
+    return true;
+}
+
+bool KSymCache::store( std::string_view symFileName, uint64_t key ) const
+{
+    std::error_code ec;
+
+    auto size = fs::file_size( symFileName, ec );
+    if( ec )
+        return false;
+
+    if( !_cacheDir.empty())
+    {
+        auto cached = cachedName( key );
+
+        if( !fs::exists( cached, ec ))
+        {
+            fs::create_directories( _cacheDir, ec );
+
+            // copy to a temporary file, then rename it, not to expose a
+            // partial file to other processes sharing the cache directory
+            auto temp = cached + "." + keyString( std::random_device()());
+
+            if( !fs::copy_file( symFileName, temp, ec ))
+                return false;
+
+            fs::rename( temp, cached, ec );
+            if( ec )
+            {
+                fs::remove( temp, ec );
+
+                return false;
+            }
+        }
+    }
+
+    std::ofstream ofs( stampName( symFileName ));
+
+    ofs << keyString( key ) << " " << size << "\n";
+
+    return static_cast< bool >( ofs );
+}
+
+std::string KSymCache::stampName( std::string_view symFileName )
+{
+    return fs::path( symFileName ).replace_extension(".ksc").string();
+}
+
+std::string KSymCache::cachedName( uint64_t key ) const
+{
+    return ( fs::path( _cacheDir ) / ( keyString( key ) + ".sym")).string();
+}
@@ -0,0 +1,94 @@
+/*
+ * KSymCache
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KSYMCACHE_H
+#define KMAPSYM_KSYMCACHE_H
+
+#include <string>
+#include <string_view>
+
+#include <cstdint>
+
+/**
+ * Content-hash cache of .SYM files
+ *
+ * A stamp file next to a .SYM file records the key of the .MAP file and the
+ * options the .SYM file was generated from. If a cache directory is given,
+ * generated .SYM files are also kept there by their keys, and copied back
+ * when the same key is seen again.
+ */
+class KSymCache
+{
+public:
+    /**
+     * Constructor
+     *
+     * @param[in] cacheDir  Cache directory. Empty for stamp files only
+     */
+    explicit KSymCache( std::string_view cacheDir = {});
+
+    /**
+     * Calculate a cache key
+     *
+     * @param[in] mapData   Contents of a .MAP file
+     * @param[in] options   Options affecting a .SYM file
+     * @return              Cache key
+     */
+    static uint64_t key( std::string_view mapData, std::string_view options );
+
+    /**
+     * Look up a .SYM file
+     *
+     * If a .SYM file is not up to date but the cache directory has one for
+     * @p key, it is copied to @p symFileName.
+     *
+     * @param[in] symFileName   .SYM file name
+     * @param[in] key           Cache key
+     * @return                  true if @p symFileName is up to date,
+     *                          otherwise false
+     */
+    bool lookup( std::string_view symFileName, uint64_t key ) const;
+
+    /**
+     * Store a generated .SYM file
+     *
+     * @param[in] symFileName   .SYM file name
+     * @param[in] key           Cache key
+     * @return                  true if success, otherwise false
+     */
+    bool store( std::string_view symFileName, uint64_t key ) const;
+
+private:
+    std::string _cacheDir;  ///< cache directory
+
+    /**
+     * Get a stamp file name of a .SYM file
+     *
+     * @param[in] symFileName   .SYM file name
+     * @return                  Stamp file name
+     */
+    static std::string stampName( std::string_view symFileName );
+
+    /**
+     * Get a file name of a cached .SYM file
+     *
+     * @param[in] key   Cache key
+     * @return          Cached .SYM file name
+     */
+    std::string cachedName( uint64_t key ) const;
+};
+
+#endif
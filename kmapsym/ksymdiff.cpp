@@ -0,0 +1,850 @@
+/*
+ * K SymDiff: compare symbols of two builds
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "kmapparser.h"
+#include "kibmmapparser.h"
+#include "kwatcommapparser.h"
+#include "ksymreader.h"
+#include "kcollation.h"
+#include "kthreadpool.h"
+#include "kverbose.h"
+
+#include <iostream>
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cctype>
+#include <cstdlib>
+
+#define verb KVerbose::instance()
+
+/// no matching symbol
+static constexpr uint32_t NoMatch = ~uint32_t( 0 );
+
+/// size of output to print at once
+static constexpr size_t OutputChunkSize = 1024 * 1024;
+
+/**
+ * Input file
+ */
+struct Input
+{
+    std::string file;   ///< .MAP or .SYM file name
+    bool watcom;        ///< Watcom map file
+};
+
+/**
+ * Options
+ */
+struct Options
+{
+    bool summary = false;           ///< print only the summary
+    size_t jobs = 0;                ///< # of threads. 0 for # of CPUs
+    std::vector< Input > inputs;    ///< old and new files
+};
+
+/**
+ * Segment of a symbol set
+ *
+ * Segments and groups of the same segment number are merged as KSymWriter
+ * does.
+ */
+struct Segment
+{
+    std::string_view name;  ///< name of the segment
+    uint32_t length = 0;    ///< length of the segment
+    uint32_t nSyms = 0;     ///< # of symbols
+    bool defined = false;   ///< defined by a segment or a group
+};
+
+/**
+ * Symbol of a symbol set
+ */
+struct Symbol
+{
+    KMapParser::Addr addr;  ///< address, or value if constant
+    uint32_t size;          ///< gap to the next symbol or the segment end
+    std::string_view name;  ///< name of the symbol
+};
+
+/**
+ * Symbols of a build
+ */
+struct SymbolSet
+{
+    std::unique_ptr< KMapParser > parser;   ///< parser keeping the names
+    KSymReader reader;                      ///< reader keeping the names
+    std::vector< Segment > segments;        ///< segments by segment number
+    std::vector< Symbol > symbols;          ///< symbols in order of value
+
+    /**
+     * Get a segment, and add it if not yet
+     */
+    Segment& segmentAt( uint32_t segNum )
+    {
+        if( segNum >= segments.size())
+            segments.resize( segNum + 1 );
+
+        return segments[ segNum ];
+    }
+
+    /**
+     * Define a segment by a segment or a group
+     */
+    void define( KMapParser::Addr addr, uint32_t length,
+                 std::string_view name, bool grp )
+    {
+        uint32_t segNum = KMapParser::addrSeg( addr );
+
+        // ignore 0000:xxxxxxxx
+        if( segNum == 0 )
+            return;
+
+        auto& seg = segmentAt( segNum );
+        uint32_t end = KMapParser::addrOfs( addr ) + length;
+
+        if( !seg.defined || grp )
+            seg.name = name;
+
+        if( seg.length < end )
+            seg.length = end;
+
+        seg.defined = true;
+    }
+};
+
+/**
+ * Sink keeping records of a .MAP file in a symbol set
+ */
+struct SetSink
+{
+    SymbolSet& set;         ///< set to keep records in
+    bool byName = false;    ///< publics by name kept
+
+    /**
+     * Ignore a module name
+     */
+    void module( std::string_view ) {}
+
+    /**
+     * Keep a segment
+     */
+    void segment( const KMapParser::Segment& seg )
+    {
+        set.define( seg.addr, seg.length, seg.name, false );
+    }
+
+    /**
+     * Keep a group
+     */
+    void group( const KMapParser::Group& grp )
+    {
+        set.define( grp.addr, grp.length, grp.name, true );
+    }
+
+    /**
+     * Keep a public symbol
+     */
+    void publicSym( const KMapParser::Public& pub, KMapParser::State st )
+    {
+        if( st == KMapParser::State::PublicsByName )
+            byName = true;
+
+        set.symbols.push_back({ pub.addr, 0, pub.name });
+    }
+
+    /**
+     * Ignore an import
+     */
+    void import( const KMapParser::Import& ) {}
+
+    /**
+     * Ignore an entry point
+     */
+    void entry( std::string_view ) {}
+
+    /**
+     * Ignore a source file of line numbers
+     */
+    void lineFile( std::string_view ) {}
+
+    /**
+     * Ignore a line number
+     */
+    void lineNumber( uint32_t, KMapParser::Addr ) {}
+
+    /**
+     * Sort the publics by value if they are by name
+     *
+     * @remark The order is the same as KMapParser::sortPublics() except
+     *         the same names at the same address. But the names need not
+     *         be sorted to do so
+     */
+    void finish()
+    {
+        if( !byName )
+            return;
+
+        KCollation coll( KCollation::Fold::Upper );
+
+        std::sort( set.symbols.begin(), set.symbols.end(),
+                   [ & ]( const Symbol& a, const Symbol& b ) {
+                       if( a.addr != b.addr )
+                           return a.addr < b.addr;
+
+                       return coll.compare( a.name, b.name ) < 0; });
+    }
+};
+
+/**
+ * Show usage
+ */
+static void showUsage()
+{
+    verb.out() << "\
+Usage: ksymdiff [options] [map_type] old_file [map_type] new_file\n\
+Compare symbols of two builds in .MAP or .SYM files\n\
+map_type:\n\
+    -i: IBM map file follows (default)\n\
+    -w: Watcom map file follows\n\
+options:\n\
+    -s: Print only the summary\n\
+    -j N: Use N threads (default: # of CPUs)\n\
+Sizes of symbols are the gaps to the next symbols or the ends of segments.\n\
+.SYM files have no lengths of segments, so their last symbols are sized 0.\n\
+Exit status is 0 if the same, 1 if different, 2 if trouble\n\
+";
+}
+
+/**
+ * Load symbols of a .MAP file
+ *
+ * @param[in]  input    .MAP file
+ * @param[in]  pool     Thread pool to use
+ * @param[out] set      Symbols loaded
+ * @return              true if success, otherwise false
+ */
+static bool loadMap( const Input& input, KThreadPool& pool, SymbolSet& set )
+{
+    if( input.watcom )
+        set.parser = std::make_unique< KWatcomMapParser >();
+    else
+        set.parser = std::make_unique< KIbmMapParser >();
+
+    auto& parser = *set.parser;
+
+    parser.setThreadPool( &pool );
+
+    // IBM maps have both publics by name and by value
+    parser.setSections( KMapParser::SecSegments | KMapParser::SecGroups
+                        | ( input.watcom ? KMapParser::SecPublicsByName
+                                         : KMapParser::SecPublicsByValue ));
+
+    SetSink sink{ set };
+
+    if( !parser.open( input.file ))
+        return false;
+
+    bool ok = input.watcom ? parser.parseTo< KWatcomMapParser >( sink )
+                           : parser.parseTo< KIbmMapParser >( sink );
+
+    if( ok )
+        sink.finish();
+
+    return ok;
+}
+
+/**
+ * Load symbols of a .SYM file
+ *
+ * @param[in]  input    .SYM file
+ * @param[out] set      Symbols loaded
+ * @return              true if success, otherwise false
+ */
+static bool loadSym( const Input& input, SymbolSet& set )
+{
+    auto& reader = set.reader;
+
+    if( !reader.open( input.file ))
+        return false;
+
+    const KSymReader::Segment *block;
+
+    // blocks of a segment are in order of address
+    for( size_t i = 0; ( block = reader.block( i )); i++ )
+    {
+        auto& seg = set.segmentAt( block->segNum );
+
+        seg.name = block->name;
+        seg.defined = block->segNum != 0;
+
+        for( size_t j = 0; j < block->nSyms; j++ )
+        {
+            auto sym = KSymReader::symbol( *block, j );
+
+            set.symbols.push_back({
+                KMapParser::makeAddr( block->segNum, sym.addr ), 0,
+                sym.name });
+
+            // the last symbol is the best guess of the end
+            if( block->segNum != 0 && seg.length < sym.addr )
+                seg.length = sym.addr;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Load symbols of a build, and size them
+ *
+ * @param[in]  input    .MAP or .SYM file
+ * @param[in]  pool     Thread pool to use
+ * @param[out] set      Symbols loaded
+ * @return              true if success, otherwise false
+ */
+static bool load( const Input& input, KThreadPool& pool, SymbolSet& set )
+{
+    auto ext = std::filesystem::path( input.file ).extension().string();
+
+    std::transform( ext.begin(), ext.end(), ext.begin(),
+                    []( unsigned char c ) { return std::tolower( c ); });
+
+    if( !( ext == ".sym" ? loadSym( input, set )
+                         : loadMap( input, pool, set )))
+        return false;
+
+    auto& syms = set.symbols;
+
+    for( size_t i = 0; i < syms.size(); i++ )
+    {
+        uint32_t segNum = KMapParser::addrSeg( syms[ i ].addr );
+        uint32_t ofs = KMapParser::addrOfs( syms[ i ].addr );
+
+        // constants have no sizes
+        if( segNum == 0 )
+            continue;
+
+        auto& seg = set.segmentAt( segNum );
+        uint32_t end = seg.length;
+
+        if( i + 1 < syms.size()
+            && KMapParser::addrSeg( syms[ i + 1 ].addr ) == segNum )
+            end = KMapParser::addrOfs( syms[ i + 1 ].addr );
+
+        syms[ i ].size = end > ofs ? end - ofs : 0;
+        seg.nSyms++;
+    }
+
+    return true;
+}
+
+/**
+ * Match symbols of two builds
+ *
+ * The lists by value are merged first, which matches the symbols at the
+ * same addresses in linear time. Only the rest are sorted by name, and
+ * merged again.
+ *
+ * @param[in]  oldSyms  Symbols of the old build in order of value
+ * @param[in]  newSyms  Symbols of the new build in order of value
+ * @param[out] oldMatch Index of the new symbol matching each old one, or
+ *                      @ref NoMatch
+ * @param[out] newMatch Index of the old symbol matching each new one, or
+ *                      @ref NoMatch
+ */
+static void match( const std::vector< Symbol >& oldSyms,
+                   const std::vector< Symbol >& newSyms,
+                   std::vector< uint32_t >& oldMatch,
+                   std::vector< uint32_t >& newMatch )
+{
+    // same as the order of KMapParser::sortPublics()
+    KCollation coll( KCollation::Fold::Upper );
+
+    oldMatch.assign( oldSyms.size(), NoMatch );
+    newMatch.assign( newSyms.size(), NoMatch );
+
+    std::vector< uint32_t > oldRest;
+    std::vector< uint32_t > newRest;
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    while( i < oldSyms.size() && j < newSyms.size())
+    {
+        const auto& o = oldSyms[ i ];
+        const auto& n = newSyms[ j ];
+        int cmp = o.addr < n.addr ? -1 : o.addr > n.addr ? 1
+                                       : coll.compare( o.name, n.name );
+
+        if( cmp < 0 )
+            oldRest.push_back( i++ );
+        else if( cmp > 0 )
+            newRest.push_back( j++ );
+        else
+        {
+            oldMatch[ i ] = j;
+            newMatch[ j ] = i;
+
+            i++;
+            j++;
+        }
+    }
+
+    for( ; i < oldSyms.size(); i++ )
+        oldRest.push_back( i );
+
+    for( ; j < newSyms.size(); j++ )
+        newRest.push_back( j );
+
+    // the same names keep their order. so duplicates are paired in order
+    coll.sort( oldRest, [ & ]( uint32_t k ) { return oldSyms[ k ].name; });
+    coll.sort( newRest, [ & ]( uint32_t k ) { return newSyms[ k ].name; });
+
+    i = 0;
+    j = 0;
+
+    while( i < oldRest.size() && j < newRest.size())
+    {
+        int cmp = coll.compare( oldSyms[ oldRest[ i ]].name,
+                                newSyms[ newRest[ j ]].name );
+
+        if( cmp < 0 )
+            i++;
+        else if( cmp > 0 )
+            j++;
+        else
+        {
+            oldMatch[ oldRest[ i ]] = newRest[ j ];
+            newMatch[ newRest[ j ]] = oldRest[ i ];
+
+            i++;
+            j++;
+        }
+    }
+}
+
+/**
+ * Buffer of output printed in chunks
+ */
+struct Output
+{
+    std::string buf;    ///< output not printed yet
+
+    /**
+     * Destructor
+     */
+    ~Output() { flush(); }
+
+    /**
+     * Print the output buffered
+     */
+    void flush()
+    {
+        verb.out() << buf;
+        buf.clear();
+    }
+
+    /**
+     * Finish a line, and print the output if the buffer is full
+     */
+    void endLine()
+    {
+        buf += '\n';
+
+        if( buf.size() >= OutputChunkSize )
+            flush();
+    }
+
+    /**
+     * Append text padded to a width
+     *
+     * @param[in] text  Text to append
+     * @param[in] width Width to pad to
+     * @param[in] left  true to align to the left, false to the right
+     */
+    void put( std::string_view text, size_t width = 0, bool left = false )
+    {
+        size_t pad = text.size() < width ? width - text.size() : 0;
+
+        if( !left )
+            buf.append( pad, ' ');
+
+        buf += text;
+
+        if( left )
+            buf.append( pad, ' ');
+    }
+
+    /**
+     * Append a number in decimal padded to a width
+     *
+     * @param[in] n     Number to append
+     * @param[in] width Width to pad to
+     * @param[in] sign  true to prefix + to a positive number
+     */
+    void putNum( int64_t n, size_t width, bool sign = false )
+    {
+        char num[ 24 ];
+        char *p = num;
+
+        if( sign && n > 0 )
+            *p++ = '+';
+
+        auto res = std::to_chars( p, num + sizeof( num ), n );
+
+        put({ num, static_cast< size_t >( res.ptr - num )}, width );
+    }
+
+    /**
+     * Append an address in ssss:oooooooo form
+     *
+     * @param[in] addr  Address to append
+     */
+    void putAddr( KMapParser::Addr addr )
+    {
+        char num[] = "0000:00000000";
+
+        hex( num, 4, KMapParser::addrSeg( addr ));
+        hex( num + 5, 8, KMapParser::addrOfs( addr ));
+
+        buf.append( num, sizeof( num ) - 1 );
+    }
+
+    /**
+     * Write a number in hexadecimal right-aligned to zeros
+     *
+     * @param[in] p     Buffer filled with zeros
+     * @param[in] width Width of @p p
+     * @param[in] n     Number to write
+     */
+    static void hex( char *p, size_t width, uint32_t n )
+    {
+        static const char digits[] = "0123456789ABCDEF";
+
+        for( size_t k = width; k > 0 && n; k--, n >>= 4 )
+            p[ k - 1 ] = digits[ n & 0xF ];
+    }
+};
+
+/**
+ * Print the sizes of segments of two builds
+ *
+ * @param[in] oldSet    Symbols of the old build
+ * @param[in] newSet    Symbols of the new build
+ * @param[in] out       Output
+ */
+static void printSegments( const SymbolSet& oldSet, const SymbolSet& newSet,
+                           Output& out )
+{
+    /**
+     * Segment row
+     */
+    struct Row
+    {
+        std::string_view name;      ///< name of the segment
+        const Segment *oldSeg;      ///< segment of the old build
+        const Segment *newSeg;      ///< segment of the new build
+    };
+
+    std::vector< Row > rows;
+
+    // the same names are the same segments even if renumbered
+    for( const auto& seg: newSet.segments )
+    {
+        if( seg.defined )
+            rows.push_back({ seg.name, nullptr, &seg });
+    }
+
+    for( const auto& seg: oldSet.segments )
+    {
+        if( !seg.defined )
+            continue;
+
+        auto it = std::find_if( rows.begin(), rows.end(),
+                                [ & ]( const Row& row ) {
+                                    return !row.oldSeg
+                                           && row.name == seg.name; });
+
+        if( it != rows.end())
+            it->oldSeg = &seg;
+        else
+            rows.push_back({ seg.name, &seg, nullptr });
+    }
+
+    out.put("segment", 16, true );
+    out.put("old size", 12 );
+    out.put("new size", 12 );
+    out.put("delta", 12 );
+    out.put("old syms", 10 );
+    out.put("new syms", 10 );
+    out.endLine();
+
+    for( const auto& row: rows )
+    {
+        int64_t oldLen = row.oldSeg ? row.oldSeg->length : 0;
+        int64_t newLen = row.newSeg ? row.newSeg->length : 0;
+
+        out.put( row.name, 16, true );
+
+        if( row.oldSeg )
+            out.putNum( oldLen, 12 );
+        else
+            out.put("-", 12 );
+
+        if( row.newSeg )
+            out.putNum( newLen, 12 );
+        else
+            out.put("-", 12 );
+
+        out.putNum( newLen - oldLen, 12, true );
+        out.putNum( row.oldSeg ? row.oldSeg->nSyms : 0, 10 );
+        out.putNum( row.newSeg ? row.newSeg->nSyms : 0, 10 );
+        out.endLine();
+    }
+}
+
+/**
+ * Compare symbols of two builds, and print the differences
+ *
+ * @param[in] oldSet    Symbols of the old build
+ * @param[in] newSet    Symbols of the new build
+ * @param[in] opts      Options
+ * @return              true if the same, otherwise false
+ */
+static bool diff( const SymbolSet& oldSet, const SymbolSet& newSet,
+                  const Options& opts )
+{
+    const auto& oldSyms = oldSet.symbols;
+    const auto& newSyms = newSet.symbols;
+    std::vector< uint32_t > oldMatch;
+    std::vector< uint32_t > newMatch;
+
+    match( oldSyms, newSyms, oldMatch, newMatch );
+
+    size_t nRemoved = std::count( oldMatch.begin(), oldMatch.end(),
+                                  NoMatch );
+    size_t nAdded = std::count( newMatch.begin(), newMatch.end(), NoMatch );
+    size_t nMoved = 0;
+    size_t nResized = 0;
+
+    for( size_t j = 0; j < newSyms.size(); j++ )
+    {
+        if( newMatch[ j ] == NoMatch )
+            continue;
+
+        const auto& o = oldSyms[ newMatch[ j ]];
+
+        if( o.addr != newSyms[ j ].addr )
+            nMoved++;
+        else if( o.size != newSyms[ j ].size )
+            nResized++;
+    }
+
+    Output out;
+
+    printSegments( oldSet, newSet, out );
+
+    // print a header of a list
+    auto header = [ & ]( std::string_view title, size_t n )
+    {
+        out.endLine();
+        out.put( title );
+        out.put(": ");
+        out.putNum( n, 0 );
+        out.endLine();
+    };
+
+    // print an address, a size and a name of a symbol
+    auto symbol = [ & ]( const Symbol& sym )
+    {
+        out.put("  ");
+        out.putAddr( sym.addr );
+        out.putNum( sym.size, 10 );
+        out.put("  ");
+        out.put( sym.name );
+        out.endLine();
+    };
+
+    if( !opts.summary )
+    {
+        header("Removed symbols", nRemoved );
+
+        for( size_t i = 0; i < oldSyms.size(); i++ )
+        {
+            if( oldMatch[ i ] == NoMatch )
+                symbol( oldSyms[ i ]);
+        }
+
+        header("Added symbols", nAdded );
+
+        for( size_t j = 0; j < newSyms.size(); j++ )
+        {
+            if( newMatch[ j ] == NoMatch )
+                symbol( newSyms[ j ]);
+        }
+
+        header("Moved symbols", nMoved );
+
+        for( size_t j = 0; j < newSyms.size(); j++ )
+        {
+            if( newMatch[ j ] == NoMatch )
+                continue;
+
+            const auto& o = oldSyms[ newMatch[ j ]];
+            const auto& n = newSyms[ j ];
+
+            if( o.addr == n.addr )
+                continue;
+
+            out.put("  ");
+            out.putAddr( o.addr );
+            out.putNum( o.size, 10 );
+            out.put("  ");
+            out.putAddr( n.addr );
+            out.putNum( n.size, 10 );
+            out.put("  ");
+            out.put( n.name );
+            out.endLine();
+        }
+
+        header("Resized symbols", nResized );
+
+        for( size_t j = 0; j < newSyms.size(); j++ )
+        {
+            if( newMatch[ j ] == NoMatch )
+                continue;
+
+            const auto& o = oldSyms[ newMatch[ j ]];
+            const auto& n = newSyms[ j ];
+
+            if( o.addr != n.addr || o.size == n.size )
+                continue;
+
+            out.put("  ");
+            out.putAddr( n.addr );
+            out.putNum( o.size, 10 );
+            out.putNum( n.size, 10 );
+            out.putNum( int64_t( n.size ) - o.size, 10, true );
+            out.put("  ");
+            out.put( n.name );
+            out.endLine();
+        }
+    }
+
+    out.endLine();
+    out.putNum( nRemoved, 0 );
+    out.put(" removed, ");
+    out.putNum( nAdded, 0 );
+    out.put(" added, ");
+    out.putNum( nMoved, 0 );
+    out.put(" moved, ");
+    out.putNum( nResized, 0 );
+    out.put(" resized");
+    out.endLine();
+
+    return nRemoved == 0 && nAdded == 0 && nMoved == 0 && nResized == 0;
+}
+
+int main( int argc, char *argv[])
+{
+    Options opts;
+    bool watcom = false;
+
+    std::ios::sync_with_stdio( false );
+
+    for( int i = 1; i < argc; i++ )
+    {
+        std::string arg( argv[ i ]);
+
+        if( arg.compare("-i") == 0 )
+            watcom = false;
+        else if( arg.compare("-w") == 0 )
+            watcom = true;
+        else if( arg.compare("-s") == 0 )
+            opts.summary = true;
+        else if( arg.compare( 0, 2, "-j") == 0 )
+        {
+            std::string n( arg.substr( 2 ));
+
+            if( n.empty() && i + 1 < argc )
+                n = argv[ ++i ];
+
+            char *end;
+            opts.jobs = std::strtoul( n.c_str(), &end, 10 );
+            if( n.empty() || *end != '\0' || opts.jobs == 0 )
+            {
+                verb.err() << "Invalid number of jobs: " << n << "\n";
+                showUsage();
+
+                return 2;
+            }
+        }
+        else if( arg[ 0 ] == '-')
+        {
+            verb.err() << "Invalid argument: " << arg << "!!!\n";
+            showUsage();
+
+            return 2;
+        }
+        else
+        {
+            std::filesystem::path path( arg );
+
+            if( path.extension().empty())
+                path += ".map";
+
+            opts.inputs.push_back({ path.string(), watcom });
+        }
+    }
+
+    if( opts.inputs.size() != 2 )
+    {
+        verb.err() << "Need old and new files!!!\n";
+        showUsage();
+
+        return 2;
+    }
+
+    KThreadPool pool( opts.jobs );
+    SymbolSet sets[ 2 ];
+    bool ok[ 2 ];
+
+    // load both builds at once. parsers use the pool, too
+    pool.run( 2, [ & ]( size_t i )
+    {
+        ok[ i ] = load( opts.inputs[ i ], pool, sets[ i ]);
+    });
+
+    for( size_t i = 0; i < 2; i++ )
+    {
+        if( !ok[ i ])
+        {
+            verb.err() << "Cannot read " << opts.inputs[ i ].file << "!!!\n";
+
+            return 2;
+        }
+    }
+
+    verb.out() << "--- " << opts.inputs[ 0 ].file << "\n"
+               << "+++ " << opts.inputs[ 1 ].file << "\n";
+
+    return diff( sets[ 0 ], sets[ 1 ], opts ) ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+/*
+ * .SYM file format
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KSYMFORMAT_H
+#define KMAPSYM_KSYMFORMAT_H
+
+#include <cstdint>
+
+#pragma pack( push, 1 )
+
+/******************************************************************************
+
+.SYM file structure
+
+     +-------------------+-------------------+
+     | PART              | TYPE              |
+     +-------------------+-------------------+
+     | HEADER            | SymHeader         |
+     +-------------------+-------------------+
+     | CONSTANTS         | SymbolInfo        |
+     +-------------------+-------------------+
+     | OFFSET TABLE OF   | OffsetTable       |
+     | CONSTANTS         |                   |
+     |                   |                   |
+     +---- PARAGRAPH(16 bytes) ALIGNMENT ----+
+     |                   |                   |
+     | SEGMENT HEADER    | SegmentInfo       |
+     +-------------------+-------------------+
+     | SEGMENT SYMBOLS   | SymbolInfo        |
+     +-------------------+-------------------+
+     | OFFSET TABLE OF   | OffsetTable       |
+     | SYMBOLS           |                   |
+     |                   |                   |
+     +---- PARAGRAPH(16 bytes) ALIGNMENT ----+
+     |                   |                   |
+     |                 REPEAT                |
+     |                   |                   |
+     +---- PARAGRAPH(16 bytes) ALIGNMENT ----+
+     |                   |                   |
+     | LINE INFO         | LineDef           |
+     +-------------------+-------------------+
+     | LINES             | LineInfo          |
+     |                   |                   |
+     +---- PARAGRAPH(16 bytes) ALIGNMENT ----+
+     |                   |                   |
+     |                 REPEAT                |
+     |                   |                   |
+     +---- PARAGRAPH(16 bytes) ALIGNMENT ----+
+     |                   |                   |
+     | MARK OF END       | MSB 0x00 0x00 LSB |
+     +-------------------+-------------------+
+     | GENERATOR VERSION | MSB 0x05 0x01 LSB |
+     +-------------------+-------------------+
+
+* SymbolInfo
+    type addr;
+        type is uint16_t if all the constant values and the symbol addresses
+                            are 16-bit (addrType == 2)
+        type is uint32_t if any of the constant values and the symbol addresses
+                            is 32-bit (addrType == 3)
+        addr is a value if constant
+        addr is an address if segment
+
+    uint8_t nameLen;
+        length of constant/symbol name
+
+    uint8_t name[ nameLen ];
+        constant/symbol name
+
+* OffsetTable
+    uint16_t offsetsByValue[ nSyms ];
+        sorted by value in constants or address in segments
+
+    uint16_t offsetsByName[ nSyms ];
+        sorted by name converted to lowercase
+        optional
+
+        offset is to symbols from .SYM file header if constants
+                             from segment header if segment symbols
+
+* LineInfo
+    type addr;
+        type is uint16_t if the segment is 16-bit (addrType == 2)
+        type is uint32_t if the segment is 32-bit (addrType == 3)
+        addr is an offset in the segment
+
+    uint16_t line;
+        line number. Line numbers above 65535 do not fit, and are dropped
+
+    LineInfos of a LineDef are sorted by offset. LineDefs of a segment are
+    chained from lineDefPara of its SegmentInfo
+
+* Split segment
+    Offsets of symbols are 16-bit. So a segment whose header and symbols
+    exceed 65535 bytes is split into consecutive blocks with the same segment
+    number, in order of address. nSegs counts the blocks
+
+******************************************************************************/
+
+/**
+ * Revision of .SYM files written by K MapSym. Bump whenever the output for
+ * the same .MAP file and options changes
+ *
+ * 1: baseline
+ * 2: oversized segments split into blocks
+ * 3: line numbers with -n
+ * 4: line numbers above 65535 dropped
+ */
+constexpr uint32_t SymOutputRevision = 4;
+
+/**
+ * Address type
+ */
+enum class AddrType : uint16_t {
+    Bit16 = 2,  ///< 16-bit address
+    Bit32 = 3   ///< 32-bit address
+};
+
+/**
+ * Header of .SYM file
+ */
+struct SymHeader
+{
+    uint16_t fileSizePara;  ///< 00: .SYM file size in para
+                            ///<     except mark of end and generator version
+    AddrType addrType;      ///< 02: 2 for 16-bit, 3 for 32-bit
+    uint16_t entrySegNum;   ///< 04: segment number containing the entry point
+    uint16_t nConsts;       ///< 06: # of constants
+    uint16_t headerSize;    ///< 08: size of header + constants in bytes
+    uint16_t nSegs;         ///< 10: # of segments except constants
+    uint16_t firstSegPara;  ///< 12: offset to the first segment in para from
+                            ///<     the beginning of .SYM file
+    uint8_t  maxSymNameLen; ///< 14: max. length of symbol names in .SYM file
+    // followed by:
+    // uint8_t  nameLen;            ///< 15: module name length
+    // uint8_t  name[ nameLen ];    ///< 16: module name
+};
+
+/**
+ * Segment info of .SYM file
+ */
+struct SegmentInfo
+{
+    uint16_t nextSegPara;   ///< 0: offset to next segment in para from the
+                            ///<    beginning of .SYM file
+    uint16_t nSyms;         ///< 2: number of symbols in this block
+    uint16_t segSize;       ///< 4: size of segment header + symbols in bytes
+    uint16_t segNum;        ///< 6: segment number
+    uint16_t r8;            ///< 8: reserved
+    uint16_t ra;            ///< 10: reserved
+    uint16_t rc;            ///< 12: reserved
+    AddrType addrType;      ///< 14: 2 for 16-bit, 3 for 32-bit
+    uint16_t lineDefPara;   ///< 16: offset to the first line def in para
+                            ///<     from the beginning of .SYM file. 0 if
+                            ///<     no line numbers
+    uint16_t u12;           ///< 18: unknown, usually 0xFF00
+    // followed by:
+    // uint8_t nameLen;         ///< 20: segment name length
+    // uint8_t name[ nameLen ]; ///< 21: segment name
+};
+
+/**
+ * Line def of .SYM file
+ */
+struct LineDef
+{
+    uint16_t nextLineDefPara;   ///< 0: offset to next line def of the same
+                                ///<    segment in para from the beginning of
+                                ///<    .SYM file. 0 if last
+    uint16_t r2;                ///< 2: reserved
+    uint16_t linesOfs;          ///< 4: offset to line infos from line def
+    uint16_t r6;                ///< 6: reserved
+    uint16_t nLines;            ///< 8: # of line infos
+    // followed by:
+    // uint8_t nameLen;         ///< 10: source file name length
+    // uint8_t name[ nameLen ]; ///< 11: source file name
+};
+
+#pragma pack( pop )
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * .KSI file format
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KSYMINDEXFORMAT_H
+#define KMAPSYM_KSYMINDEXFORMAT_H
+
+#include <cstdint>
+
+/******************************************************************************
+
+.KSI file structure
+
+     +-------------------+-------------------+
+     | PART              | TYPE              |
+     +-------------------+-------------------+
+     | HEADER            | KsiHeader         |
+     +-------------------+-------------------+
+     | STRING POOL       | char[]            |
+     +------ 8 BYTES ALIGNMENT --------------+
+     | SEGMENTS          | KsiSegment[]      |
+     +-------------------+-------------------+
+     | SYMBOLS           | KsiSymbol[]       |
+     +-------------------+-------------------+
+     | NAME INDEX        | uint32_t[]        |
+     +------ 8 BYTES ALIGNMENT --------------+
+     | IMPORTS           | KsiImport[]       |
+     +-------------------+-------------------+
+
+* All the values are little-endian, and all the records are naturally
+  aligned. So a mapped file is used as it is without parsing.
+
+* Addresses are packed as segment number in the upper 32 bits and offset in
+  the lower 32 bits, like KMapParser::Addr. Constants are in segment 0.
+
+* SYMBOLS are sorted by address, and NAME INDEX holds indexes to SYMBOLS
+  sorted by name converted to lowercase.
+
+* Readers accept files of the same major version. A minor version may only
+  append fields to KsiHeader, whose size is given by headerSize.
+
+******************************************************************************/
+
+/**
+ * Magic of .KSI file
+ */
+static constexpr char KsiMagic[ 4 ] = { 'K', 'S', 'I', '\x1A' };
+
+static constexpr uint16_t KsiMajor = 1; ///< major version
+static constexpr uint16_t KsiMinor = 0; ///< minor version
+
+/**
+ * String in the string pool
+ */
+struct KsiString
+{
+    uint32_t ofs;           ///< offset in the string pool
+    uint32_t len;           ///< length
+};
+
+/**
+ * Section of .KSI file
+ */
+struct KsiSection
+{
+    uint64_t ofs;           ///< offset from the beginning of .KSI file
+    uint64_t count;         ///< # of records, or bytes of the string pool
+};
+
+/**
+ * Header of .KSI file
+ */
+struct KsiHeader
+{
+    char magic[ 4 ];        ///< 00: KsiMagic
+    uint16_t major;         ///< 04: major version
+    uint16_t minor;         ///< 06: minor version
+    uint32_t headerSize;    ///< 08: size of the header in bytes
+    uint32_t reserved;      ///< 12: reserved, 0
+    uint64_t fileSize;      ///< 16: size of .KSI file in bytes
+    uint64_t entryPoint;    ///< 24: address of the entry point.
+                            ///<     ~0 if unknown
+    KsiString moduleName;   ///< 32: module name
+    KsiSection strings;     ///< 40: string pool
+    KsiSection segments;    ///< 56: segments
+    KsiSection symbols;     ///< 72: symbols sorted by address
+    KsiSection names;       ///< 88: indexes to symbols sorted by name
+    KsiSection imports;     ///< 104: imports
+};
+
+/**
+ * Segment of .KSI file
+ */
+struct KsiSegment
+{
+    uint64_t addr;          ///< address of the segment
+    uint32_t length;        ///< length of the segment
+    uint32_t nBits;         ///< # of bits of the segment. 0 if unknown
+    KsiString name;         ///< name of the segment
+    KsiString className;    ///< class name of the segment
+};
+
+/**
+ * Symbol of .KSI file
+ */
+struct KsiSymbol
+{
+    uint64_t addr;          ///< address of the symbol, or value if constant
+    KsiString name;         ///< name of the symbol
+};
+
+/**
+ * Import of .KSI file
+ */
+struct KsiImport
+{
+    uint64_t addr;          ///< address of the import. ~0 if unknown
+    KsiString name;         ///< name of the import
+    KsiString dllName;      ///< dll name of the import
+    KsiString dllOrdOrExp;  ///< ordinal or export entry of the import
+};
+
+static_assert( sizeof( KsiHeader ) == 120, "KsiHeader layout");
+static_assert( sizeof( KsiSegment ) == 32, "KsiSegment layout");
+static_assert( sizeof( KsiSymbol ) == 16, "KsiSymbol layout");
+static_assert( sizeof( KsiImport ) == 32, "KsiImport layout");
+
+#endif
@@ -0,0 +1,176 @@
+/*
+ * KSymIndexReader
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "ksymindexreader.h"
+#include "kverbose.h"
+
+#include <algorithm>
+
+#include <cstring>
+
+#define verb KVerbose::instance()
+
+bool KSymIndexReader::open( std::string_view fileName )
+{
+    close();
+
+    _fileName = fileName;
+
+    if( !_file.open( _fileName ))
+        return false;
+
+    auto data = _file.view();
+
+    if( data.size() >= sizeof( _header ))
+        std::memcpy( &_header, data.data(), sizeof( _header ));
+
+    bool valid = data.size() >= sizeof( _header )
+                 && std::memcmp( _header.magic, KsiMagic,
+                                 sizeof( _header.magic )) == 0
+                 && _header.headerSize >= sizeof( _header )
+                 && _header.fileSize == data.size();
+
+    if( valid && _header.major != KsiMajor )
+    {
+        verb.err() << "Unsupported .KSI version " << _header.major << "."
+                   << _header.minor << ": " << _fileName << "!!!\n";
+
+        close();
+
+        return false;
+    }
+
+    if( valid )
+    {
+        _strings = sectionData( _header.strings, 1 );
+        _segments = reinterpret_cast< const KsiSegment * >(
+                        sectionData( _header.segments, sizeof( KsiSegment )));
+        _symbols = reinterpret_cast< const KsiSymbol * >(
+                        sectionData( _header.symbols, sizeof( KsiSymbol )));
+        _names = reinterpret_cast< const uint32_t * >(
+                        sectionData( _header.names, sizeof( uint32_t )));
+        _imports = reinterpret_cast< const KsiImport * >(
+                        sectionData( _header.imports, sizeof( KsiImport )));
+
+        valid = _strings && _segments && _symbols && _names && _imports
+                && _header.names.count == _header.symbols.count;
+    }
+
+    if( !valid )
+    {
+        verb.err() << "Invalid .KSI file: " << _fileName << "!!!\n";
+
+        close();
+
+        return false;
+    }
+
+    return true;
+}
+
+void KSymIndexReader::close()
+{
+    _file.close();
+
+    _header = {};
+    _strings = nullptr;
+    _segments = nullptr;
+    _symbols = nullptr;
+    _names = nullptr;
+    _imports = nullptr;
+}
+
+bool KSymIndexReader::lookup( Addr addr, Symbol& sym, uint32_t& disp ) const
+{
+    auto end = _symbols + symbolCount();
+
+    // find the first symbol after addr
+    auto it = std::upper_bound( _symbols, end, addr,
+                                []( Addr a, const KsiSymbol& s )
+    {
+        return a < s.addr;
+    });
+
+    // no symbols at or before addr in the same segment
+    if( it == _symbols || ( it - 1 )->addr >> 32 != addr >> 32 )
+        return false;
+
+    sym = symbol( it - 1 - _symbols );
+    disp = static_cast< uint32_t >( addr - sym.addr );
+
+    return true;
+}
+
+size_t KSymIndexReader::findName( std::string_view name,
+                                  std::vector< Symbol >& matches,
+                                  bool prefix ) const
+{
+    size_t nSyms = symbolCount();
+
+    auto nameAt = [ & ]( size_t i ) -> std::string_view
+    {
+        // ignore a broken index
+        return _names[ i ] < nSyms ? symbol( _names[ i ]).name
+                                   : std::string_view();
+    };
+
+    // find the first name not less than name
+    size_t lo = 0;
+    size_t hi = nSyms;
+
+    while( lo < hi )
+    {
+        size_t mid = lo + ( hi - lo ) / 2;
+
+        if( _coll.compareFolded( nameAt( mid ), name ) < 0 )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    size_t count = 0;
+
+    // names matched are contiguous
+    for( ; lo < nSyms; lo++ )
+    {
+        auto symName = nameAt( lo );
+
+        if( prefix )
+            symName = symName.substr( 0, name.size());
+
+        if( _coll.compareFolded( symName, name ) != 0 )
+            break;
+
+        matches.push_back( symbol( _names[ lo ]));
+        ++count;
+    }
+
+    return count;
+}
+
+const char *KSymIndexReader::sectionData( const KsiSection& section,
+                                          size_t size ) const
+{
+    auto data = _file.view();
+
+    // records are naturally aligned
+    if( section.ofs % std::min< size_t >( size, 8 ) != 0
+        || section.ofs > data.size()
+        || section.count > ( data.size() - section.ofs ) / size )
+        return nullptr;
+
+    return data.data() + section.ofs;
+}
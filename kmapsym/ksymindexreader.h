@@ -0,0 +1,226 @@
+/*
+ * KSymIndexReader
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KSYMINDEXREADER_H
+#define KMAPSYM_KSYMINDEXREADER_H
+
+#include "kmappedfile.h"
+#include "ksymindexformat.h"
+#include "kcollation.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * .KSI reader class
+ *
+ * Maps a .KSI file into memory, and uses its records as they are. Opening
+ * checks the header and the bounds of the sections only. Names are returned
+ * as views into the mapped file. So they are valid until close() is called.
+ */
+class KSymIndexReader
+{
+public:
+    /**
+     * Packed address. Segment number in the upper 32 bits, and offset in
+     * the lower 32 bits, like KMapParser::Addr
+     */
+    using Addr = uint64_t;
+
+    /**
+     * Symbol structure
+     */
+    struct Symbol
+    {
+        Addr addr;              ///< address of the symbol, or value if constant
+        std::string_view name;  ///< name of the symbol
+    };
+
+    /**
+     * Segment structure
+     */
+    struct Segment
+    {
+        Addr addr;                  ///< address of the segment
+        uint32_t length;            ///< length of the segment
+        uint32_t nBits;             ///< # of bits of the segment. 0 if unknown
+        std::string_view name;      ///< name of the segment
+        std::string_view className; ///< class name of the segment
+    };
+
+    /**
+     * Import structure
+     */
+    struct Import
+    {
+        Addr addr;                      ///< address of the import. ~0 if
+                                        ///< unknown
+        std::string_view name;          ///< name of the import
+        std::string_view dllName;       ///< dll name of the import
+        std::string_view dllOrdOrExp;   ///< ordinal or export entry of the
+                                        ///< import. may be empty
+    };
+
+    /**
+     * Constructor
+     */
+    KSymIndexReader() = default;
+
+    /**
+     * Open a .KSI file
+     *
+     * @param[in] fileName  .KSI file name to open
+     * @return              true if success, otherwise false
+     */
+    bool open( std::string_view fileName );
+
+    /**
+     * Close a .KSI file
+     */
+    void close();
+
+    /**
+     * Check if a .KSI file is open
+     */
+    bool isOpen() const { return _file.isOpen(); }
+
+    /**
+     * Get the module name
+     */
+    std::string_view moduleName() const { return str( _header.moduleName ); }
+
+    /**
+     * Get the address of the entry point. ~0 if unknown
+     */
+    Addr entryPoint() const { return _header.entryPoint; }
+
+    /**
+     * Get the # of segments
+     */
+    size_t segmentCount() const { return _header.segments.count; }
+
+    /**
+     * Get a segment
+     *
+     * @param[in] i     Index of a segment. Should be less than segmentCount()
+     * @return          Segment
+     */
+    Segment segment( size_t i ) const
+    {
+        const auto& seg = _segments[ i ];
+
+        return { seg.addr, seg.length, seg.nBits, str( seg.name ),
+                 str( seg.className )};
+    }
+
+    /**
+     * Get the # of symbols including constants
+     */
+    size_t symbolCount() const { return _header.symbols.count; }
+
+    /**
+     * Get a symbol in order of address
+     *
+     * @param[in] i     Index of a symbol. Should be less than symbolCount()
+     * @return          Symbol
+     */
+    Symbol symbol( size_t i ) const
+    {
+        return { _symbols[ i ].addr, str( _symbols[ i ].name )};
+    }
+
+    /**
+     * Get the # of imports
+     */
+    size_t importCount() const { return _header.imports.count; }
+
+    /**
+     * Get an import
+     *
+     * @param[in] i     Index of an import. Should be less than importCount()
+     * @return          Import
+     */
+    Import import( size_t i ) const
+    {
+        const auto& imp = _imports[ i ];
+
+        return { imp.addr, str( imp.name ), str( imp.dllName ),
+                 str( imp.dllOrdOrExp )};
+    }
+
+    /**
+     * Look up the symbol at or preceding an address in the same segment
+     *
+     * @param[in]  addr     Address
+     * @param[out] sym      Symbol found
+     * @param[out] disp     Displacement of @p addr from @p sym
+     * @return              true if found, otherwise false
+     */
+    bool lookup( Addr addr, Symbol& sym, uint32_t& disp ) const;
+
+    /**
+     * Look up symbols by name case-insensitively
+     *
+     * @param[in]  name     Name or prefix of names to find
+     * @param[out] matches  List to append matches to, in order of names
+     * @param[in]  prefix   true to find names starting with @p name
+     * @return              # of matches appended
+     */
+    size_t findName( std::string_view name, std::vector< Symbol >& matches,
+                     bool prefix = false ) const;
+
+private:
+    std::string _fileName;              ///< .KSI file name
+    KMappedFile _file;                  ///< mapped .KSI file
+
+    KsiHeader _header{};                ///< header of .KSI file
+    const char *_strings = nullptr;     ///< string pool
+    const KsiSegment *_segments = nullptr;  ///< segments
+    const KsiSymbol *_symbols = nullptr;    ///< symbols sorted by address
+    const uint32_t *_names = nullptr;   ///< indexes to symbols sorted by name
+    const KsiImport *_imports = nullptr;    ///< imports
+
+    /// collation of the index sorted by name
+    KCollation _coll{ KCollation::Fold::Lower };
+
+    /**
+     * Get a string in the string pool
+     *
+     * @remark Returns an empty string if out of bounds
+     */
+    std::string_view str( const KsiString& s ) const
+    {
+        if( static_cast< uint64_t >( s.ofs ) + s.len > _header.strings.count )
+            return {};
+
+        return { _strings + s.ofs, s.len };
+    }
+
+    /**
+     * Get a section after checking its bounds
+     *
+     * @param[in] section   Section
+     * @param[in] size      Size of a record in bytes
+     * @return              Section data, or nullptr if out of bounds
+     */
+    const char *sectionData( const KsiSection& section, size_t size ) const;
+};
+
+#endif
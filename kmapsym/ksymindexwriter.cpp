@@ -0,0 +1,157 @@
+/*
+ * KSymIndexWriter
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "ksymindexwriter.h"
+#include "kcollation.h"
+#include "kverbose.h"
+#include "kstats.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include <cstring>
+
+#define verb KVerbose::instance()
+
+bool KSymIndexWriter::write( std::string_view fileName,
+                             const KMapParser& parser )
+{
+    KStats::Timer timer( KStats::Phase::Write );
+
+    _image.assign( sizeof( KsiHeader ), '\0');
+    _strings.clear();
+    _stringMap.clear();
+
+    KsiHeader header{};
+
+    std::memcpy( header.magic, KsiMagic, sizeof( header.magic ));
+    header.major = KsiMajor;
+    header.minor = KsiMinor;
+    header.headerSize = sizeof( header );
+    header.moduleName = addString( parser.moduleName());
+
+    KMapParser::Addr entryPoint;
+
+    header.entryPoint = KMapParser::parseAddr( parser.entryPoint(),
+                                               entryPoint ) ?
+                        entryPoint : KMapParser::NoAddr;
+
+    std::vector< KsiSegment > segs;
+
+    segs.reserve( parser.segments().size());
+
+    for( const auto& seg: parser.segments())
+    {
+        segs.push_back({ seg.addr, seg.length,
+                         static_cast< uint32_t >( seg.nBits ),
+                         addString( seg.name ), addString( seg.className )});
+    }
+
+    auto publics = parser.publicsByValue();
+    std::vector< KsiSymbol > syms;
+
+    syms.reserve( publics.size());
+
+    for( const auto& pub: publics )
+        syms.push_back({ pub.addr, addString( pub.name )});
+
+    // publics by value of a .MAP file may not be sorted
+    std::stable_sort( syms.begin(), syms.end(),
+                      []( const KsiSymbol& a, const KsiSymbol& b )
+    {
+        return a.addr < b.addr;
+    });
+
+    // compare strings case-insensitively by converting to lowercase
+    KCollation coll( KCollation::Fold::Lower );
+
+    std::vector< uint32_t > names( syms.size());
+
+    for( uint32_t i = 0; i < names.size(); i++ )
+        names[ i ] = i;
+
+    coll.sort( names, [ & ]( uint32_t i ) -> std::string_view
+    {
+        return { _strings.data() + syms[ i ].name.ofs, syms[ i ].name.len };
+    });
+
+    std::vector< KsiImport > imps;
+
+    imps.reserve( parser.imports().size());
+
+    for( const auto& imp: parser.imports())
+    {
+        imps.push_back({ imp.addr, addString( imp.name ),
+                         addString( imp.dllName ),
+                         addString( imp.dllOrdOrExp )});
+    }
+
+    header.strings = append( _strings.data(), _strings.size());
+    header.segments = append( segs.data(), segs.size() * sizeof( segs[ 0 ]));
+    header.segments.count = segs.size();
+    header.symbols = append( syms.data(), syms.size() * sizeof( syms[ 0 ]));
+    header.symbols.count = syms.size();
+    header.names = append( names.data(), names.size() * sizeof( names[ 0 ]));
+    header.names.count = names.size();
+    header.imports = append( imps.data(), imps.size() * sizeof( imps[ 0 ]));
+    header.imports.count = imps.size();
+
+    header.fileSize = _image.size();
+
+    std::memcpy( _image.data(), &header, sizeof( header ));
+
+    std::ofstream ofs( std::string( fileName ),
+                       std::ios::out | std::ios::binary );
+
+    if( !( ofs && ofs.write( _image.data(), _image.size()) && ofs.flush()))
+    {
+        verb.err() << "Cannot write " << fileName << "!!!\n";
+
+        return false;
+    }
+
+    KStats::instance().add( KStats::Counter::BytesWritten, _image.size());
+
+    return true;
+}
+
+KsiString KSymIndexWriter::addString( std::string_view sv )
+{
+    auto it = _stringMap.find( sv );
+    if( it != _stringMap.end())
+        return it->second;
+
+    KsiString str{ static_cast< uint32_t >( _strings.size()),
+                   static_cast< uint32_t >( sv.size())};
+
+    _strings.append( sv );
+    _stringMap.emplace( sv, str );
+
+    return str;
+}
+
+KsiSection KSymIndexWriter::append( const void *data, size_t n )
+{
+    // align to 8 bytes
+    _image.resize(( _image.size() + 7 ) & ~size_t( 7 ), '\0');
+
+    KsiSection section{ _image.size(), n };
+
+    _image.insert( _image.end(), static_cast< const char * >( data ),
+                   static_cast< const char * >( data ) + n );
+
+    return section;
+}
@@ -0,0 +1,77 @@
+/*
+ * KSymIndexWriter
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KSYMINDEXWRITER_H
+#define KMAPSYM_KSYMINDEXWRITER_H
+
+#include "kmapparser.h"
+#include "ksymindexformat.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * .KSI writer class
+ *
+ * Writes all the records of a parsed .MAP file to a .KSI file, which has no
+ * limits of .SYM format. See ksymindexformat.h for the layout.
+ */
+class KSymIndexWriter
+{
+public:
+    /**
+     * Write a .KSI file
+     *
+     * @param[in] fileName  .KSI file name to write
+     * @param[in] parser    Parser which parsed a .MAP file
+     * @return              true if succeeds, otherwise false
+     */
+    bool write( std::string_view fileName, const KMapParser& parser );
+
+private:
+    std::vector< char > _image;     ///< whole .KSI file image
+    std::string _strings;           ///< string pool
+
+    /// strings in the string pool
+    std::unordered_map< std::string_view, KsiString > _stringMap;
+
+    /**
+     * Add a string to the string pool
+     *
+     * @param[in] sv    String to add
+     * @return          String in the string pool
+     * @remark          Adds the same strings only once. @p sv should be
+     *                  valid until write() returns
+     */
+    KsiString addString( std::string_view sv );
+
+    /**
+     * Append records to the image
+     *
+     * @param[in] data  Records to append
+     * @param[in] n     Size of the records in bytes
+     * @return          Section of the records
+     * @remark          Aligns the records to 8 bytes
+     */
+    KsiSection append( const void *data, size_t n );
+};
+
+#endif
@@ -0,0 +1,367 @@
+/*
+ * KSymReader
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "ksymreader.h"
+#include "kverbose.h"
+
+#include <algorithm>
+
+#define verb KVerbose::instance()
+
+bool KSymReader::open( std::string_view fileName )
+{
+    close();
+
+    _fileName = fileName;
+
+    if( !_file.open( _fileName ))
+        return false;
+
+    auto data = _file.view();
+
+    std::memcpy( &_header, data.data(),
+                 std::min( data.size(), sizeof( _header )));
+
+    size_t nameOfs = sizeof( _header ) + 1;
+
+    if( data.size() < nameOfs
+        || nameOfs + static_cast< uint8_t >( data[ nameOfs - 1 ])
+           > data.size())
+    {
+        verb.err() << "Invalid .SYM file: " << _fileName << "!!!\n";
+
+        close();
+
+        return false;
+    }
+
+    _moduleName = { data.data() + nameOfs,
+                    static_cast< uint8_t >( data[ nameOfs - 1 ])};
+
+    _nextSegPara = _header.nSegs > 0 ? _header.firstSegPara : 0;
+
+    // constants are placed in the header block
+    if( _header.nConsts > 0 )
+    {
+        Segment seg{ 0, "<Constants>", _header.addrType, _header.nConsts,
+                     data.data(), data.data() + _header.headerSize };
+
+        // followed by the first segment, or the mark of end
+        size_t blockEnd = _nextSegPara > 0 ? _nextSegPara * 16
+                                           : data.size() - 4;
+
+        if( !addSegment( seg, nameOfs + _moduleName.size(), blockEnd ))
+        {
+            close();
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void KSymReader::close()
+{
+    _file.close();
+
+    _header = {};
+    _moduleName = {};
+    _segments.clear();
+    _nextSegPara = 0;
+}
+
+const KSymReader::Segment *KSymReader::segment( uint16_t segNum )
+{
+    for( const auto& entry: _segments )
+    {
+        if( entry.seg.segNum == segNum )
+            return &entry.seg;
+    }
+
+    // not read yet
+    while( auto seg = readNextSegment())
+    {
+        if( seg->segNum == segNum )
+            return seg;
+    }
+
+    return nullptr;
+}
+
+std::vector< const KSymReader::Segment * >
+KSymReader::segmentBlocks( uint16_t segNum )
+{
+    std::vector< const Segment * > blocks;
+
+    for( size_t i = 0; i < _segments.size() || readNextSegment(); i++ )
+    {
+        const auto& seg = _segments[ i ].seg;
+
+        if( seg.segNum == segNum )
+            blocks.push_back( &seg );
+        else if( !blocks.empty())
+            break;
+    }
+
+    return blocks;
+}
+
+const KSymReader::Segment *KSymReader::block( size_t i )
+{
+    while( i >= _segments.size())
+    {
+        if( !readNextSegment())
+            return nullptr;
+    }
+
+    return &_segments[ i ].seg;
+}
+
+bool KSymReader::lookup( uint16_t segNum, uint32_t ofs, Symbol& sym,
+                         uint32_t& disp )
+{
+    auto blocks = segmentBlocks( segNum );
+
+    // find the last block starting at or before ofs
+    const Segment *seg = nullptr;
+
+    for( auto block: blocks )
+    {
+        if( block->nSyms > 0 && ( !seg || symbol( *block, 0 ).addr <= ofs ))
+            seg = block;
+        else
+            break;
+    }
+
+    if( !seg )
+        return false;
+
+    // find the first symbol after ofs
+    size_t lo = 0;
+    size_t hi = seg->nSyms;
+
+    while( lo < hi )
+    {
+        size_t mid = lo + ( hi - lo ) / 2;
+
+        if( symbol( *seg, mid ).addr <= ofs )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    // no symbols at or before ofs
+    if( lo == 0 )
+        return false;
+
+    sym = symbol( *seg, lo - 1 );
+    disp = ofs - sym.addr;
+
+    return true;
+}
+
+size_t KSymReader::findName( std::string_view name,
+                             std::vector< Match >& matches, bool prefix )
+{
+    // names are sorted in each segment. read all the segments
+    while( readNextSegment())
+        /* nothing */;
+
+    size_t count = 0;
+
+    for( auto& entry: _segments )
+    {
+        const auto& seg = entry.seg;
+        auto table = nameTable( entry );
+
+        auto nameAt = [ & ]( size_t i )
+        {
+            return symbolAt( seg, get16( table + i * 2 )).name;
+        };
+
+        // find the first name not less than name
+        size_t lo = 0;
+        size_t hi = seg.nSyms;
+
+        while( lo < hi )
+        {
+            size_t mid = lo + ( hi - lo ) / 2;
+
+            if( _coll.compareFolded( nameAt( mid ), name ) < 0 )
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        // names matched are contiguous
+        for( ; lo < seg.nSyms; lo++ )
+        {
+            auto symName = nameAt( lo );
+
+            if( prefix )
+                symName = symName.substr( 0, name.size());
+
+            if( _coll.compareFolded( symName, name ) != 0 )
+                break;
+
+            matches.push_back({ seg.segNum,
+                                symbolAt( seg, get16( table + lo * 2 ))});
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+bool KSymReader::checkTable( const Segment& seg, const char *table,
+                             size_t symStart, size_t symEnd )
+{
+    size_t addrSize = seg.addrType == AddrType::Bit32 ? 4 : 2;
+
+    // every symbol should be in the symbol area
+    for( size_t i = 0; i < seg.nSyms; i++ )
+    {
+        size_t ofs = get16( table + i * 2 );
+
+        if( ofs < symStart || ofs + addrSize + 1 > symEnd
+            || ofs + addrSize + 1
+               + static_cast< uint8_t >( seg.base[ ofs + addrSize ])
+               > symEnd )
+            return false;
+    }
+
+    return true;
+}
+
+const KSymReader::Segment *KSymReader::addSegment( const Segment& seg,
+                                                   size_t symStart,
+                                                   size_t blockEnd )
+{
+    auto data = _file.view();
+    size_t base = seg.base - data.data();
+    size_t symEnd = seg.ofsByValue - seg.base;
+
+    bool valid = ( seg.addrType == AddrType::Bit16
+                   || seg.addrType == AddrType::Bit32 )
+                 && symStart <= symEnd
+                 && base + symEnd + seg.nSyms * 2 <= data.size()
+                 && checkTable( seg, seg.ofsByValue, symStart, symEnd );
+
+    if( !valid )
+    {
+        verb.err() << "Invalid segment " << seg.segNum << " in "
+                   << _fileName << "!!!\n";
+
+        return nullptr;
+    }
+
+    blockEnd = std::min( blockEnd, data.size() - base );
+
+    _segments.push_back({ seg, symStart, blockEnd, nullptr, {}});
+
+    return &_segments.back().seg;
+}
+
+const char *KSymReader::nameTable( SegmentEntry& entry )
+{
+    if( entry.ofsByName )
+        return entry.ofsByName;
+
+    const auto& seg = entry.seg;
+    size_t symEnd = seg.ofsByValue - seg.base;
+    const char *table = seg.ofsByValue + seg.nSyms * 2;
+
+    // the table sorted by name is optional. use it only if it fits in the
+    // block, points to symbols and is sorted
+    bool valid = symEnd + seg.nSyms * 4 <= entry.blockEnd
+                 && checkTable( seg, table, entry.symStart, symEnd );
+
+    for( size_t i = 1; valid && i < seg.nSyms; i++ )
+    {
+        valid = _coll.compareFolded(
+                    symbolAt( seg, get16( table + ( i - 1 ) * 2 )).name,
+                    symbolAt( seg, get16( table + i * 2 )).name ) <= 0;
+    }
+
+    if( valid )
+    {
+        entry.ofsByName = table;
+
+        return table;
+    }
+
+    // build one
+    auto& index = entry.nameIndex;
+
+    index.resize( seg.nSyms );
+
+    for( size_t i = 0; i < seg.nSyms; i++ )
+        index[ i ] = get16( seg.ofsByValue + i * 2 );
+
+    _coll.sort( index, [ & ]( uint16_t ofs )
+    {
+        return symbolAt( seg, ofs ).name;
+    });
+
+    entry.ofsByName = reinterpret_cast< const char * >( index.data());
+
+    return entry.ofsByName;
+}
+
+const KSymReader::Segment *KSymReader::readNextSegment()
+{
+    if( _nextSegPara == 0 )
+        return nullptr;
+
+    auto data = _file.view();
+    size_t pos = _nextSegPara * 16;
+    size_t nameOfs = sizeof( SegmentInfo ) + 1;
+
+    _nextSegPara = 0;
+
+    if( pos + nameOfs > data.size()
+        || pos + nameOfs + static_cast< uint8_t >( data[ pos + nameOfs - 1 ])
+           > data.size())
+    {
+        verb.err() << "Invalid segment chain in " << _fileName << "!!!\n";
+
+        return nullptr;
+    }
+
+    SegmentInfo info;
+
+    std::memcpy( &info, data.data() + pos, sizeof( info ));
+
+    const char *base = data.data() + pos;
+    Segment seg{ info.segNum,
+                 { base + nameOfs,
+                   static_cast< uint8_t >( base[ nameOfs - 1 ])},
+                 info.addrType, info.nSyms, base, base + info.segSize };
+
+    // the chain should go forward
+    size_t nextSegPara = info.nextSegPara > pos / 16 ? info.nextSegPara : 0;
+
+    // followed by the next segment, or the mark of end
+    size_t blockEnd = nextSegPara > 0 ? nextSegPara * 16 - pos
+                                      : data.size() - 4 - pos;
+
+    auto added = addSegment( seg, nameOfs + seg.name.size(), blockEnd );
+    if( added )
+        _nextSegPara = nextSegPara;
+
+    return added;
+}
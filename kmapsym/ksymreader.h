@@ -0,0 +1,288 @@
+/*
+ * KSymReader
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KSYMREADER_H
+#define KMAPSYM_KSYMREADER_H
+
+#include "kmappedfile.h"
+#include "ksymformat.h"
+#include "kcollation.h"
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * .SYM reader class
+ *
+ * Maps a .SYM file into memory, and reads segments on demand by following
+ * the segment chain. Names are returned as views into the mapped file. So
+ * they are valid until close() is called.
+ */
+class KSymReader
+{
+public:
+    /**
+     * Symbol structure
+     */
+    struct Symbol
+    {
+        uint32_t addr;          ///< offset of the symbol, or value if constant
+        std::string_view name;  ///< name of the symbol
+    };
+
+    /**
+     * Segment structure
+     */
+    struct Segment
+    {
+        uint16_t segNum;            ///< segment number. 0 for constants
+        std::string_view name;      ///< name of the segment
+        AddrType addrType;          ///< address type of symbols
+        uint16_t nSyms;             ///< # of symbols
+        const char *base;           ///< base of symbol offsets
+        const char *ofsByValue;     ///< offset table sorted by value
+    };
+
+    /**
+     * Match of name lookup
+     */
+    struct Match
+    {
+        uint16_t segNum;    ///< segment number. 0 for constants
+        Symbol sym;         ///< symbol matched
+    };
+
+    /**
+     * Constructor
+     */
+    KSymReader() = default;
+
+    /**
+     * Open a .SYM file
+     *
+     * @param[in] fileName  .SYM file name to open
+     * @return              true if success, otherwise false
+     */
+    bool open( std::string_view fileName );
+
+    /**
+     * Close a .SYM file
+     */
+    void close();
+
+    /**
+     * Check if a .SYM file is open
+     */
+    bool isOpen() const { return _file.isOpen(); }
+
+    /**
+     * Get the module name
+     */
+    std::string_view moduleName() const { return _moduleName; }
+
+    /**
+     * Get the segment number containing the entry point
+     */
+    uint16_t entrySegNum() const { return _header.entrySegNum; }
+
+    /**
+     * Get the # of segments except constants
+     */
+    uint16_t segmentCount() const { return _header.nSegs; }
+
+    /**
+     * Find a segment, or its first block
+     *
+     * @param[in] segNum    Segment number. 0 for constants
+     * @return              Segment if found, otherwise nullptr
+     * @remark              Reads the segment chain up to @p segNum if not
+     *                      read yet
+     */
+    const Segment *segment( uint16_t segNum );
+
+    /**
+     * Find all the blocks of a segment
+     *
+     * @param[in] segNum    Segment number. 0 for constants
+     * @return              Blocks in order of address. Empty if not found
+     * @remark              A segment with too many symbols for a block is
+     *                      split into consecutive blocks with the same
+     *                      segment number
+     */
+    std::vector< const Segment * > segmentBlocks( uint16_t segNum );
+
+    /**
+     * Get a block in order of the file
+     *
+     * @param[in] i     Index of a block. The constants come first if any
+     * @return          Block if found, otherwise nullptr
+     * @remark          Reads the segment chain up to the block if not read
+     *                  yet
+     */
+    const Segment *block( size_t i );
+
+    /**
+     * Get a symbol in order of value
+     *
+     * @param[in] seg   Segment
+     * @param[in] i     Index of a symbol. Should be less than seg.nSyms
+     * @return          Symbol
+     */
+    static Symbol symbol( const Segment& seg, size_t i )
+    {
+        return symbolAt( seg, get16( seg.ofsByValue + i * 2 ));
+    }
+
+    /**
+     * Look up the symbol at or preceding an address
+     *
+     * @param[in]  segNum   Segment number
+     * @param[in]  ofs      Offset in the segment
+     * @param[out] sym      Symbol found
+     * @param[out] disp     Displacement of @p ofs from @p sym
+     * @return              true if found, otherwise false
+     */
+    bool lookup( uint16_t segNum, uint32_t ofs, Symbol& sym, uint32_t& disp );
+
+    /**
+     * Look up symbols by name case-insensitively
+     *
+     * @param[in]  name     Name or prefix of names to find
+     * @param[out] matches  List to append matches to, in order of segments
+     *                      and then names
+     * @param[in]  prefix   true to find names starting with @p name
+     * @return              # of matches appended
+     * @remark              Uses the offset tables sorted by name if any.
+     *                      Otherwise, builds them on the first call
+     */
+    size_t findName( std::string_view name, std::vector< Match >& matches,
+                     bool prefix = false );
+
+private:
+    /**
+     * Segment entry
+     */
+    struct SegmentEntry
+    {
+        Segment seg;                ///< segment
+        size_t symStart;            ///< offset of the first symbol from base
+        size_t blockEnd;            ///< offset of the end of block from base
+        const char *ofsByName;      ///< offset table sorted by name.
+                                    ///< nullptr if not checked yet
+        std::vector< uint16_t > nameIndex;  ///< built table sorted by name
+    };
+
+    std::string _fileName;              ///< .SYM file name
+    KMappedFile _file;                  ///< mapped .SYM file
+    SymHeader _header{};                ///< header of .SYM file
+    std::string_view _moduleName;       ///< module name
+
+    std::deque< SegmentEntry > _segments;   ///< segments read so far
+    size_t _nextSegPara = 0;            ///< next segment to read in para.
+                                        ///< 0 if no more segments
+
+    /// collation of the tables sorted by name
+    KCollation _coll{ KCollation::Fold::Lower };
+
+    /**
+     * Read a 16-bit value
+     */
+    static uint16_t get16( const char *p )
+    {
+        uint16_t u16;
+
+        std::memcpy( &u16, p, sizeof( u16 ));
+
+        return u16;
+    }
+
+    /**
+     * Read a 32-bit value
+     */
+    static uint32_t get32( const char *p )
+    {
+        uint32_t u32;
+
+        std::memcpy( &u32, p, sizeof( u32 ));
+
+        return u32;
+    }
+
+    /**
+     * Get a symbol at an offset
+     *
+     * @param[in] seg   Segment
+     * @param[in] ofs   Offset of the symbol from seg.base
+     * @return          Symbol
+     */
+    static Symbol symbolAt( const Segment& seg, uint16_t ofs )
+    {
+        const char *p = seg.base + ofs;
+
+        if( seg.addrType == AddrType::Bit32 )
+            return { get32( p ), { p + 5, static_cast< uint8_t >( p[ 4 ])}};
+
+        return { get16( p ), { p + 3, static_cast< uint8_t >( p[ 2 ])}};
+    }
+
+    /**
+     * Check if an offset table points to symbols only
+     *
+     * @param[in] seg       Segment
+     * @param[in] table     Offset table to check
+     * @param[in] symStart  Offset of the first symbol from seg.base
+     * @param[in] symEnd    Offset of the end of symbols from seg.base
+     * @return              true if valid, otherwise false
+     */
+    static bool checkTable( const Segment& seg, const char *table,
+                            size_t symStart, size_t symEnd );
+
+    /**
+     * Add a segment entry after validating it
+     *
+     * @param[in] seg       Segment to add
+     * @param[in] symStart  Offset of the first symbol from seg.base
+     * @param[in] blockEnd  Offset of the end of block from seg.base
+     * @return              Segment added, or nullptr if invalid
+     */
+    const Segment *addSegment( const Segment& seg, size_t symStart,
+                               size_t blockEnd );
+
+    /**
+     * Get the offset table sorted by name of a segment
+     *
+     * @param[in] entry     Segment entry
+     * @return              Offset table sorted by name
+     * @remark              Checks the table in the file on the first call.
+     *                      If it is missing or invalid, builds one
+     */
+    const char *nameTable( SegmentEntry& entry );
+
+    /**
+     * Read the next segment in the chain
+     *
+     * @return Segment read, or nullptr if no more segments
+     */
+    const Segment *readNextSegment();
+};
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * KSymReaderCache
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "ksymreadercache.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#include <cctype>
+
+KSymReaderCache::KSymReaderCache( size_t capacity,
+                                  std::vector< std::string > dirs )
+    : _capacity( std::max< size_t >( capacity, 1 )), _dirs( std::move( dirs ))
+{
+    if( _dirs.empty())
+        _dirs.push_back(".");
+}
+
+KSymReaderCache::Module& KSymReaderCache::get( std::string_view name )
+{
+    // strip directories and an extension
+    auto slash = name.find_last_of("/\\:");
+    if( slash != std::string_view::npos )
+        name.remove_prefix( slash + 1 );
+
+    auto dot = name.rfind('.');
+    if( dot != std::string_view::npos && dot > 0 )
+        name = name.substr( 0, dot );
+
+    std::string key( name );
+
+    // module names are case-insensitive
+    for( auto& ch: key )
+        ch = std::toupper( static_cast< unsigned char >( ch ));
+
+    auto it = _map.find( key );
+    if( it != _map.end())
+    {
+        // move to the front
+        _lru.splice( _lru.begin(), _lru, it->second );
+
+        return _lru.front();
+    }
+
+    if( _lru.size() >= _capacity )
+    {
+        _map.erase( _lru.back().name );
+        _lru.pop_back();
+    }
+
+    _lru.push_front({ key, nullptr, nullptr, {}});
+    _map[ key ] = _lru.begin();
+
+    openModule( _lru.front(), std::string( name ));
+
+    return _lru.front();
+}
+
+const KSymReaderCache::SegmentTable *
+KSymReaderCache::segment( Module& mod, uint16_t segNum )
+{
+    auto it = mod.segs.find( segNum );
+    if( it != mod.segs.end())
+        return it->second.blocks.empty() ? nullptr : &it->second;
+
+    auto& table = mod.segs[ segNum ];
+
+    if( mod.reader )
+        table.blocks = mod.reader->segmentBlocks( segNum );
+
+    if( table.blocks.empty())
+        return nullptr;
+
+    std::vector< std::pair< uint32_t, uint32_t >> syms;
+
+    // merge the blocks of a split segment
+    for( uint32_t b = 0; b < table.blocks.size(); b++ )
+    {
+        const auto& seg = *table.blocks[ b ];
+
+        for( uint32_t i = 0; i < seg.nSyms; i++ )
+            syms.push_back({ KSymReader::symbol( seg, i ).addr, b << 16 | i });
+    }
+
+    // 16-bit addresses may wrap around in a segment longer than it says
+    if( !std::is_sorted( syms.begin(), syms.end()))
+        std::sort( syms.begin(), syms.end());
+
+    table.addrs.resize( syms.size());
+    table.index.resize( syms.size());
+
+    for( size_t i = 0; i < syms.size(); i++ )
+    {
+        table.addrs[ i ] = syms[ i ].first;
+        table.index[ i ] = syms[ i ].second;
+    }
+
+    return &table;
+}
+
+void KSymReaderCache::openModule( Module& mod, const std::string& name ) const
+{
+    std::string lower( name );
+    std::string upper( name );
+
+    for( size_t i = 0; i < name.size(); i++ )
+    {
+        lower[ i ] = std::tolower( static_cast< unsigned char >( name[ i ]));
+        upper[ i ] = std::toupper( static_cast< unsigned char >( name[ i ]));
+    }
+
+    std::error_code ec;
+
+    for( const auto& dir: _dirs )
+    {
+        for( const auto& fileName: { name + ".ksi", lower + ".ksi",
+                                     upper + ".KSI" })
+        {
+            auto path = std::filesystem::path( dir ) / fileName;
+
+            if( !std::filesystem::is_regular_file( path, ec ))
+                continue;
+
+            auto index = std::make_unique< KSymIndexReader >();
+
+            if( index->open( path.string()))
+            {
+                mod.index = std::move( index );
+
+                return;
+            }
+        }
+
+        for( const auto& fileName: { name + ".sym", lower + ".sym",
+                                     upper + ".SYM" })
+        {
+            auto path = std::filesystem::path( dir ) / fileName;
+
+            if( !std::filesystem::is_regular_file( path, ec ))
+                continue;
+
+            auto reader = std::make_unique< KSymReader >();
+
+            if( reader->open( path.string()))
+            {
+                mod.reader = std::move( reader );
+
+                return;
+            }
+        }
+    }
+}
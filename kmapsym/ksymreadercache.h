@@ -0,0 +1,126 @@
+/*
+ * KSymReaderCache
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KSYMREADERCACHE_H
+#define KMAPSYM_KSYMREADERCACHE_H
+
+#include "ksymreader.h"
+#include "ksymindexreader.h"
+
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * LRU cache of .SYM readers by module name
+ *
+ * Keeps up to a given number of .SYM files mapped. Each module also keeps
+ * flat address tables of the segments looked up, so that repeated lookups
+ * do not touch the offset tables again. A .KSI file is preferred to a .SYM
+ * file if any, since it is searched as it is.
+ */
+class KSymReaderCache
+{
+public:
+    /**
+     * Address table of a segment
+     */
+    struct SegmentTable
+    {
+        /// blocks of the segment
+        std::vector< const KSymReader::Segment * > blocks;
+        std::vector< uint32_t > addrs;      ///< sorted addresses
+        std::vector< uint32_t > index;      ///< block index << 16 | symbol
+                                            ///< index of addrs
+
+        /**
+         * Get a symbol in order of addrs
+         *
+         * @param[in] i     Index of addrs
+         * @return          Symbol
+         */
+        KSymReader::Symbol symbol( size_t i ) const
+        {
+            return KSymReader::symbol( *blocks[ index[ i ] >> 16 ],
+                                       index[ i ] & 0xFFFF );
+        }
+    };
+
+    /**
+     * Module entry
+     */
+    struct Module
+    {
+        std::string name;                   ///< module name
+        std::unique_ptr< KSymReader > reader;   ///< nullptr if not found
+        std::unique_ptr< KSymIndexReader > index;   ///< nullptr if not found
+
+        /// address tables by segment number
+        std::unordered_map< uint16_t, SegmentTable > segs;
+    };
+
+    /**
+     * Constructor
+     *
+     * @param[in] capacity  Max. # of modules to keep
+     * @param[in] dirs      Directories to search .SYM files in order
+     */
+    KSymReaderCache( size_t capacity, std::vector< std::string > dirs );
+
+    /**
+     * Get a module
+     *
+     * @param[in] name  Module name. Directories and an extension are ignored
+     * @return          Module. Its reader and index are nullptr if neither
+     *                  .SYM nor .KSI file is found
+     * @remark          Valid until the next call
+     */
+    Module& get( std::string_view name );
+
+    /**
+     * Get an address table of a segment
+     *
+     * @param[in] mod       Module
+     * @param[in] segNum    Segment number
+     * @return              Address table, or nullptr if no such segment
+     */
+    static const SegmentTable *segment( Module& mod, uint16_t segNum );
+
+private:
+    size_t _capacity;                   ///< max. # of modules to keep
+    std::vector< std::string > _dirs;   ///< directories to search
+
+    std::list< Module > _lru;           ///< modules, most recent first
+
+    /// modules by name
+    std::unordered_map< std::string, std::list< Module >::iterator > _map;
+
+    /**
+     * Open a .KSI or .SYM file of a module
+     *
+     * @param[in] mod   Module to set a reader or an index to
+     * @param[in] name  Module name
+     */
+    void openModule( Module& mod, const std::string& name ) const;
+};
+
+#endif
@@ -15,7 +15,10 @@
 /** @file */
 
 #include "ksymwriter.h"
+#include "ksymformat.h"
+#include "kcollation.h"
 #include "kverbose.h"
+#include "kstats.h"
 
 #include <iostream>
 #include <iomanip>
@@ -23,137 +26,80 @@
 #include <filesystem>
 #include <algorithm>
 
-#pragma pack( push, 1 )
-
-/******************************************************************************
-
-.SYM file structure
-
-     +-------------------+-------------------+
-     | PART              | TYPE              |
-     +-------------------+-------------------+
-     | HEADER            | SymHeader         |
-     +-------------------+-------------------+
-     | CONSTANTS         | SymbolInfo        |
-     +-------------------+-------------------+
-     | OFFSET TABLE OF   | OffsetTable       |
-     | CONSTANTS         |                   |
-     |                   |                   |
-     +---- PARAGRAPH(16 bytes) ALIGNMENT ----+
-     |                   |                   |
-     | SEGMENT HEADER    | SegmentInfo       |
-     +-------------------+-------------------+
-     | SEGMENT SYMBOLS   | SymbolInfo        |
-     +-------------------+-------------------+
-     | OFFSET TABLE OF   | OffsetTable       |
-     | SYMBOLS           |                   |
-     |                   |                   |
-     +---- PARAGRAPH(16 bytes) ALIGNMENT ----+
-     |                   |                   |
-     |                 REPEAT                |
-     |                   |                   |
-     +---- PARAGRAPH(16 bytes) ALIGNMENT ----+
-     |                   |                   |
-     + LINE INFO         | Not used          |
-     |                   |                   |
-     +---- PARAGRAPH(16 bytes) ALIGNMENT ----+
-     |                   |                   |
-     | MARK OF END       | MSB 0x00 0x00 LSB |
-     +-------------------+-------------------+
-     | GENERATOR VERSION | MSB 0x05 0x01 LSB |
-     +-------------------+-------------------+
-
-* SymbolInfo
-    type addr;
-        type is uint16_t if all the constant values and the symbol addresses
-                            are 16-bit (addrType == 2)
-        type is uint32_t if any of the constant values and the symbol addresses
-                            is 32-bit (addrType == 3)
-        addr is a value if constant
-        addr is an address if segment
-
-    uint8_t nameLen;
-        length of constant/symbol name
-
-    uint8_t name[ nameLen ];
-        constant/symbol name
-
-* OffsetTable
-    uint16_t offsetsByValue[ nSyms ];
-        sorted by value in constants or address in segments
-
-    uint16_t offsetsByName[ nSyms ];
-        sorted by name converted to lowercase
-        optional
-
-        offset is to symbols from .SYM file header if constants
-                             from segment header if segment symbols
-
-******************************************************************************/
+#define verb KVerbose::instance()
 
 /**
- * Address type
+ * Convert the length of the segment to AddrType
+ *
+ * @param[in] len   Length of the segment
+ * @return          @c AddrType::Bit32 if @p len > 0xFFFF
+ * @return          @c AddrType::Bit16 otherwise
  */
-enum class AddrType : uint16_t {
-    Bit16 = 2,  ///< 16-bit address
-    Bit32 = 3   ///< 32-bit address
-};
+static inline AddrType l2a( size_t len )
+{
+    return len > 0xFFFF ? AddrType::Bit32 : AddrType::Bit16;
+}
 
 /**
- * Header of .SYM file
+ * Max. size of a block up to the end of symbols in bytes, so that offsets of
+ * symbols fit in 16 bits
  */
-struct SymHeader
+static constexpr size_t MaxBlockSize = 0xFFFF;
+
+/**
+ * Max. size of .SYM file in paragraphs
+ */
+static constexpr size_t MaxFileSizePara = 0xFFFF;
+
+/**
+ * Calculate the offset of the first symbol in a block
+ *
+ * @param[in] headerSize    Size of the header of the block
+ * @param[in] name          Name of the module or the segment
+ * @return                  Offset of the first symbol
+ */
+static inline size_t calcFirstSymOfs( size_t headerSize,
+                                      std::string_view name )
 {
-    uint16_t fileSizePara;  ///< 00: .SYM file size in para
-                            ///<     except mark of end and generator version
-    AddrType addrType;      ///< 02: 2 for 16-bit, 3 for 32-bit
-    uint16_t entrySegNum;   ///< 04: segment number containing the entry point
-    uint16_t nConsts;       ///< 06: # of constants
-    uint16_t headerSize;    ///< 08: size of header + constants in bytes
-    uint16_t nSegs;         ///< 10: # of segments except constants
-    uint16_t firstSegPara;  ///< 12: offset to the first segment in para from
-                            ///<     the beginning of .SYM file
-    uint8_t  maxSymNameLen; ///< 14: max. length of symbol names in .SYM file
-    // followed by:
-    // uint8_t  nameLen;            ///< 15: module name length
-    // uint8_t  name[ nameLen ];    ///< 16: module name
-};
+    return headerSize + sizeof( uint8_t ) + name.size();
+}
 
 /**
- * Segment info of .SYM file
+ * Calculate the size of a symbol
+ *
+ * @param[in] addrType  Address type of the segment
+ * @param[in] name      Name of the symbol
+ * @return              Size of the symbol in bytes
  */
-struct SegmentInfo
+static inline size_t calcSymSize( AddrType addrType, std::string_view name )
 {
-    uint16_t nextSegPara;   ///< 0: offset to next segment in para from the
-                            ///<    beginning of .SYM file
-    uint16_t nSyms;         ///< 2: number of symbols in this block
-    uint16_t segSize;       ///< 4: size of segment header + symbols in bytes
-    uint16_t segNum;        ///< 6: segment number
-    uint16_t r8;            ///< 8: reserved
-    uint16_t ra;            ///< 10: reserved
-    uint16_t rc;            ///< 12: reserved
-    AddrType addrType;      ///< 14: 2 for 16-bit, 3 for 32-bit
-    uint16_t r10;           ///< 16: reserved
-    uint16_t u12;           ///< 18: unknown, usually 0xFF00
-    // followed by:
-    // uint8_t nameLen;         ///< 20: segment name length
-    // uint8_t name[ nameLen ]; ///< 21: segment name
-};
-
-#pragma pack( pop )
+    return ( addrType == AddrType::Bit32 ?
+             sizeof( uint32_t ) : sizeof( uint16_t )) +
+           sizeof( uint8_t ) + name.size();
+}
 
-#define verb KVerbose::instance()
+/**
+ * Convert bytes to paragraphs
+ */
+static inline size_t b2p( size_t bytes )
+{
+    return ( bytes + 15 ) / 16;
+}
 
 /**
- * Convert the length of the segment to AddrType
+ * Calculate the size of a block including the symbol offset tables
  *
- * @param[in] len   Length of the segment
- * @return          @c AddrType::Bit32 if @p len > 0xFFFF
- * @return          @c AddrType::Bit16 otherwise
+ * @param[in] symOfs    Offset of the first symbol
+ * @param[in] nSyms     # of symbols
+ * @param[in] symSize   Size of symbols in bytes
+ * @param[in] byName    true to include the table sorted by name
+ * @return              Size of the block in bytes
  */
-static inline AddrType l2a( size_t len )
+static inline size_t calcBlockSize( size_t symOfs, size_t nSyms,
+                                    size_t symSize, bool byName )
 {
-    return len > 0xFFFF ? AddrType::Bit32 : AddrType::Bit16;
+    /* for the table sorted by addr and by name */
+    return symOfs + symSize + nSyms * sizeof( uint16_t ) * ( byName ? 2 : 1 );
 }
 
 KSymWriter::KSymWriter( std::string_view symFileName )
@@ -167,21 +113,45 @@ KSymWriter::~KSymWriter()
     close();
 }
 
-bool KSymWriter::open( std::string_view symFileName )
+bool KSymWriter::open( std::string_view symFileName, std::string_view dir )
 {
+    KStats::Timer timer( KStats::Phase::Open );
+
     if( !symFileName.empty())
         _symFileName = symFileName;
 
     if( _symFileName.empty())
         return false;
 
-    _ofs.open( std::string( _symFileName ), std::ios::out | std::ios::binary );
+    std::filesystem::path path( _symFileName );
+
+    if( !dir.empty() && path.is_relative())
+        path = std::filesystem::path( dir ) / path;
+
+    _ofs.open( path, std::ios::out | std::ios::binary );
     if( !_ofs )
         return false;
 
     return true;
 }
 
+void KSymWriter::clear()
+{
+    _lines = nullptr;
+    _moduleName.clear();
+    _entrySegNum = 0;
+    _segments.clear();
+    _syms.clear();
+    _names.clear();
+    _symsInOrder = true;
+    _nConsts = 0;
+    _constsSize = 0;
+    _minParas = 0;
+    _lastSegNum = 0;
+    _dropSegNum = 0;
+    _maxSymNameLen = 0;
+}
+
 bool KSymWriter::close()
 {
     _ofs.close();
@@ -192,20 +162,21 @@ bool KSymWriter::close()
 
 bool KSymWriter::write()
 {
+    KStats::Timer timer( KStats::Phase::Layout );
+
     if( _moduleName.empty())
         _moduleName = std::filesystem::path( _symFileName ).stem().string();
 
-    // remove segments without any symbols
-    for( auto it = _segSymsMap.begin(); it != _segSymsMap.end(); )
-    {
-        if( it->second.empty())
-            it = _segSymsMap.erase( it );
-        else
-            ++it;
+    // segments with any symbols
+    size_t nSegs = 0;
 
+    for( size_t segNum = SEG0 + 1; segNum < _segments.size(); segNum++ )
+    {
+        if( _segments[ segNum ].nSyms > 0 )
+            nSegs++;
     }
 
-    if( _segSymsMap.size() == 0 )
+    if( nSegs == 0 )
     {
         verb.err() << "No symbols found!!!\n";
 
@@ -213,135 +184,391 @@ bool KSymWriter::write()
     }
 
     verb.info() << _moduleName << std::setw( 21 - _moduleName.size())
-                << _segSymsMap.size() << " segment";
-    if( _segSymsMap.size() > 1 )
+                << nSegs << " segment";
+    if( nSegs > 1 )
         verb.info() << "s";
     verb.info() << "\n";
 
-    // calculate the offset of the first symbol
-    auto calcFirstSymOfs = []( const auto& t, std::string_view name )
+    // symbols of a segment should be contiguous. the order of the symbols
+    // in a segment is kept
+    if( !_symsInOrder )
+    {
+        std::stable_sort( _syms.begin(), _syms.end(),
+                          []( const Symbol& a, const Symbol& b )
+        {
+            return a.segNum < b.segNum;
+        });
+
+        _symsInOrder = true;
+    }
+
+    size_t first = 0;
+
+    for( auto& seg: _segments )
     {
-        return sizeof( t ) + sizeof( uint8_t ) + name.size();
+        seg.first = first;
+        first += seg.nKept;
+    }
+
+    // calculate the size of a block including the symbol offset tables
+    auto blockSize = []( const Block& block, bool byName )
+    {
+        return calcBlockSize( block.symOfs, block.nSyms, block.symSize,
+                              byName );
     };
 
-    // calculate the size of the symbol table
-    auto calcSymSize = []( AddrType addrType,
-                                 const Symbols& symbols )
+    // for statistics
+    size_t nAdded = _nConsts;
+
+    for( size_t segNum = SEG0 + 1; segNum < _segments.size(); segNum++ )
+        nAdded += _segments[ segNum ].nSyms;
+
+    auto& consts = _segments[ SEG0 ];
+    SymHeader header{};
+
+    header.addrType = l2a( consts.nKept == 0 ? 0 : consts.length );
+    header.entrySegNum = _entrySegNum;
+    header.maxSymNameLen = _maxSymNameLen;
+
+    // constants are placed in the header block. they cannot be split
+    Block constsBlock{ SEG0, _syms.data() + consts.first, 0,
+                       calcFirstSymOfs( sizeof( header ), _moduleName ),
+                       0, 0 };
+
+    for( size_t i = 0; i < consts.nKept; i++ )
+    {
+        auto symSize = calcSymSize( header.addrType,
+                                    symName( constsBlock.syms[ i ]));
+
+        if( constsBlock.symOfs + constsBlock.symSize + symSize
+                > MaxBlockSize )
+            break;
+
+        constsBlock.nSyms++;
+        constsBlock.symSize += symSize;
+    }
+
+    // including the ones not kept
+    if( constsBlock.nSyms < _nConsts )
+    {
+        verb.err() << "Too many constants. "
+                   << _nConsts - constsBlock.nSyms << " of "
+                   << _nConsts << " constants are dropped!!!\n";
+
+        // not to list them. shrinking does not move the others
+        consts.nKept = constsBlock.nSyms;
+    }
+
+    std::vector< Block > blocks{ constsBlock };
+
+    // split segments into blocks of contiguous symbols, so that offsets of
+    // symbols fit in 16 bits
+    for( size_t segNum = SEG0 + 1; segNum < _segments.size(); segNum++ )
     {
-        size_t symSize = 0;
+        const auto& segment = _segments[ segNum ];
+        auto addrType = l2a( segment.length );
+
+        // no symbols, or all the symbols were dropped when added
+        if( segment.nKept == 0 )
+            continue;
+
+        const Symbol *syms = _syms.data() + segment.first;
+
+        Block block{ segNum, syms, 0,
+                     calcFirstSymOfs( sizeof( SegmentInfo ), segment.name ),
+                     0, 0 };
 
-        for( const auto& sym: symbols )
+        for( size_t i = 0; i < segment.nKept; i++ )
         {
-            symSize += ( addrType == AddrType::Bit32 ?
-                         sizeof( uint32_t ) : sizeof( uint16_t )) +
-                       sizeof( uint8_t ) + sym.name.size();
+            auto symSize = calcSymSize( addrType, symName( syms[ i ]));
+
+            if( block.nSyms > 0
+                && block.symOfs + block.symSize + symSize > MaxBlockSize )
+            {
+                blocks.push_back( block );
+                block = { segNum, &syms[ i ], 0, block.symOfs, 0, 0 };
+            }
+
+            block.nSyms++;
+            block.symSize += symSize;
         }
 
-        return symSize;
-    };
+        blocks.push_back( block );
+    }
 
-    // calculate the size of the symbol offset table
-    auto calcSymOfsSize = [ this ]( const Symbols& symbols )
+    // lay out blocks in paragraphs, and return the file size in paragraphs
+    auto layOut = [ & ]( bool byName )
     {
-        /* for the table sorted by addr and by name */
-        return symbols.size() * sizeof( uint16_t ) *
-               ( this->_omitAlphaSort ? 1 : 2 );
+        size_t paras = 0;
+
+        for( auto& block: blocks )
+        {
+            block.ofs = paras * 16;
+            paras += b2p( blockSize( block, byName ));
+        }
+
+        return paras;
     };
 
-    // convert bytes to paragraphs
-    auto b2p = []( size_t bytes )
+    // file size in paragraphs with all the symbols added
+    auto fullSize = [ & ]( bool byName )
     {
-        return ( bytes + 15 ) / 16;
+        size_t paras = b2p( blockSize( constsBlock, byName ));
+
+        for( size_t segNum = SEG0 + 1; segNum < _segments.size(); segNum++ )
+        {
+            const auto& seg = _segments[ segNum ];
+
+            if( seg.nSyms == 0 )
+                continue;
+
+            auto symOfs = calcFirstSymOfs( sizeof( SegmentInfo ), seg.name );
+
+            paras += seg.paras[ byName ]
+                     + b2p( calcBlockSize( symOfs, seg.lastSyms,
+                                           seg.lastSize, byName ));
+        }
+
+        return paras;
     };
 
-    SymHeader header{};
+    bool byName = !_omitAlphaSort;
+    size_t fileSizePara = fullSize( byName );
 
-    header.addrType = l2a( _consts.empty() ? 0 : _segments[ SEG0 ].length );
-    header.entrySegNum = _entrySegNum;
-    header.nConsts = _consts.size();
-    header.headerSize = calcFirstSymOfs( header, _moduleName ) +
-                        calcSymSize( header.addrType, _consts );
-    header.nSegs = _segSymsMap.size();
+    if( _reportLimits )
+        reportLimits( constsBlock, fileSizePara );
 
-    auto nextSeg = b2p( header.headerSize + calcSymOfsSize( _consts ));
-    header.firstSegPara = nextSeg;
+    // too large ? drop the tables sorted by name first, which are optional
+    if( fileSizePara > MaxFileSizePara && byName )
+    {
+        verb.err() << _symFileName << " exceeds " << MaxFileSizePara
+                   << " paragraphs. Omitting alphabetical sorting\n";
 
-    header.maxSymNameLen = _maxSymNameLen;
+        byName = false;
+    }
 
-    std::map< int, SegmentInfo > segs;
+    fileSizePara = layOut( byName );
 
-    for( const auto& segSyms: _segSymsMap )
+    // still too large ? drop symbols from the end
+    if( fileSizePara > MaxFileSizePara )
     {
-        SegmentInfo seg{};
+        while( fileSizePara > MaxFileSizePara && blocks.size() > 1 )
+        {
+            auto& block = blocks.back();
+
+            if( block.ofs / 16 >= MaxFileSizePara )
+            {
+                // starts beyond the limit. drop the whole block
+                _segments[ block.segNum ].nKept -= block.nSyms;
+                blocks.pop_back();
+            }
+            else
+            {
+                auto& seg = _segments[ block.segNum ];
+
+                block.nSyms--;
+                block.symSize -= calcSymSize( l2a( seg.length ),
+                                              symName( block.syms[
+                                                        block.nSyms ]));
+                seg.nKept--;
+
+                if( block.nSyms == 0 )
+                    blocks.pop_back();
+            }
+
+            fileSizePara = blocks.back().ofs / 16
+                           + b2p( blockSize( blocks.back(), byName ));
+        }
+    }
 
-        auto addrType = l2a( _segments[ segSyms.first ].length );
+    for( size_t segNum = SEG0 + 1; segNum < _segments.size(); segNum++ )
+    {
+        const auto& seg = _segments[ segNum ];
+
+        // including the ones not kept
+        if( seg.nKept < seg.nSyms )
+        {
+            verb.err() << "Too many symbols. " << seg.nSyms - seg.nKept
+                       << " of " << seg.nSyms << " symbols in " << seg.name
+                       << " are dropped!!!\n";
+        }
+    }
+
+    if( blocks.size() == 1 )
+    {
+        verb.err() << "No symbols fit in " << _symFileName << "!!!\n";
+
+        return false;
+    }
+
+    header.nConsts = constsBlock.nSyms;
+    header.headerSize = constsBlock.symOfs + constsBlock.symSize;
+    header.nSegs = blocks.size() - 1;
+    header.firstSegPara = blocks[ 1 ].ofs / 16;
+    header.fileSizePara = fileSizePara;
+
+    std::vector< SegmentInfo > segs( blocks.size());
+
+    for( size_t i = 1; i < blocks.size(); i++ )
+    {
+        const auto& block = blocks[ i ];
+        auto& seg = segs[ i ];
 
-        seg.nSyms = segSyms.second.size();
-        seg.segSize = calcFirstSymOfs( seg, _segments[ segSyms.first ].name ) +
-                      calcSymSize( addrType, segSyms.second );
-        seg.segNum = segSyms.first;
-        seg.addrType = addrType;
+        seg.nSyms = block.nSyms;
+        seg.segSize = block.symOfs + block.symSize;
+        seg.segNum = block.segNum;
+        seg.addrType = l2a( _segments[ block.segNum ].length );
         seg.u12 = 0xFF00;
 
-        nextSeg += b2p( seg.segSize + calcSymOfsSize( segSyms.second ));
-        seg.nextSegPara = nextSeg;
+        // 0 marks the last segment
+        seg.nextSegPara = i + 1 < blocks.size() ? blocks[ i + 1 ].ofs / 16 : 0;
+    }
+
+    // line numbers follow the segments
+    std::vector< LineBlock > lineBlocks;
+
+    if( _lines && !_lines->empty())
+    {
+        fileSizePara = layOutLines( lineBlocks, fileSizePara );
+        header.fileSizePara = fileSizePara;
 
-        segs[ seg.segNum ] = seg ;
+        // point to the first line def of each segment from all its blocks
+        for( size_t i = 1; i < blocks.size(); i++ )
+        {
+            auto it = std::find_if( lineBlocks.begin(), lineBlocks.end(),
+                                    [ & ]( const LineBlock& lineBlock )
+            {
+                return lineBlock.file->segNum == blocks[ i ].segNum;
+            });
+
+            if( it != lineBlocks.end())
+                segs[ i ].lineDefPara = it->ofs / 16;
+        }
     }
 
-    // mark the last segment
-    segs.rbegin()->second.nextSegPara = 0;
+    // list symbols in order before writing them in parallel
+    listSymbols( SEG0 );
+
+    // blocks of a segment are contiguous
+    for( size_t i = 1; i < blocks.size(); )
+    {
+        size_t segNum = blocks[ i ].segNum;
+        size_t nBlocks = 0;
+
+        for( ; i < blocks.size() && blocks[ i ].segNum == segNum; i++ )
+            nBlocks++;
 
-    header.fileSizePara = nextSeg;
+        listSymbols( segNum );
 
-    // write header
-    writeData( &header, sizeof( header ));
-    writeStr( _moduleName );
+        if( nBlocks > 1 )
+        {
+            verb.info() << _segments[ segNum ].name
+                        << " is split into " << nBlocks << " blocks\n";
+        }
+    }
 
-    // write constants
-    writeSymbols( SEG0, _consts, calcFirstSymOfs( header, _moduleName ));
+    timer.phase( KStats::Phase::Write );
 
-    // write padding
-    writePadding( header.headerSize + calcSymOfsSize( _consts ));
+    // lay out the whole .SYM file in memory, then write it at once. paddings
+    // are left as zero
+    size_t imageSize = fileSizePara * 16;
 
-    // write segments
-    for( const auto& segSyms: _segSymsMap )
+    _image.assign( imageSize + sizeof( uint16_t ) * 2, '\0');
+
+    // each block goes to its own part of the image
+    auto writeBlock = [ & ]( size_t i )
     {
-        auto seg = segs[ segSyms.first ];
-        auto segName = _segments[ segSyms.first ].name;
+        const auto& block = blocks[ i ];
+        Cursor cur{ _image.data() + block.ofs };
 
-        // write segment
-        writeData( &seg, sizeof( seg ));
-        writeStr( segName );
+        if( i == 0 )
+        {
+            // write header
+            cur.writeData( &header, sizeof( header ));
+            cur.writeStr( _moduleName );
+        }
+        else
+        {
+            // write segment
+            cur.writeData( &segs[ i ], sizeof( segs[ i ]));
+            cur.writeStr( _segments[ block.segNum ].name );
+        }
 
         // write symbols
-        writeSymbols( segSyms.first, segSyms.second,
-                      calcFirstSymOfs( seg, segName ));
+        writeSymbols( cur, block, byName );
+    };
 
-        // write padding
-        writePadding( seg.segSize + calcSymOfsSize( segSyms.second ));
+    if( _pool && _pool->size() > 1 && blocks.size() > 1 )
+        _pool->run( blocks.size(), writeBlock );
+    else
+    {
+        for( size_t i = 0; i < blocks.size(); i++ )
+            writeBlock( i );
     }
 
+    writeLines( lineBlocks );
+
+    Cursor cur{ _image.data() + imageSize };
+
     // write the mark of end
-    write16( 0x0000 );
+    cur.write16( 0x0000 );
 
     // write .SYM file generator version info
-    write16( 0x0501 );
+    cur.write16( 0x0501 );
 
     verb.debug() << "Segment containing entry point: " << _entrySegNum << "\n";
 
+    if( !( _ofs.write( _image.data(), _image.size()) && _ofs.flush()))
+    {
+        verb.err() << "Cannot write " << _symFileName << "!!!\n";
+
+        return false;
+    }
+
+    auto& stats = KStats::instance();
+
+    if( stats.enabled())
+    {
+        size_t nSyms = 0;
+
+        for( size_t i = 1; i < blocks.size(); i++ )
+            nSyms += blocks[ i ].nSyms;
+
+        size_t nLines = 0;
+
+        for( const auto& lineBlock: lineBlocks )
+            nLines += lineBlock.count;
+
+        // segments written
+        nSegs = 0;
+
+        for( size_t segNum = SEG0 + 1; segNum < _segments.size(); segNum++ )
+        {
+            if( hasSymbols( segNum ))
+                nSegs++;
+        }
+
+        stats.add( KStats::Counter::BytesWritten, _image.size());
+        stats.add( KStats::Counter::Segments, nSegs );
+        stats.add( KStats::Counter::Blocks, blocks.size() - 1 );
+        stats.add( KStats::Counter::Constants, constsBlock.nSyms );
+        stats.add( KStats::Counter::Symbols, nSyms );
+        stats.add( KStats::Counter::DroppedSymbols,
+                   nAdded - constsBlock.nSyms - nSyms );
+        stats.add( KStats::Counter::LineNumbers, nLines );
+    }
+
     return true;
 }
 
 bool KSymWriter::setEntryPoint( std::string_view entryPoint )
 {
     uint32_t segNum;
+    auto end = entryPoint.data() + entryPoint.size();
 
     // take segment number only
-    auto res = std::from_chars( entryPoint.data(),
-                                entryPoint.data() + entryPoint.size(),
-                                segNum, 16 );
-    if( !( res.ec == std::errc() && *res.ptr == ':'))
+    auto res = std::from_chars( entryPoint.data(), end, segNum, 16 );
+    if( !( res.ec == std::errc() && res.ptr != end && *res.ptr == ':'))
         return false;
 
     _entrySegNum = segNum;
@@ -351,17 +578,8 @@ bool KSymWriter::setEntryPoint( std::string_view entryPoint )
 
 bool KSymWriter::addSymbol( const KMapParser::Public& sym )
 {
-    uint32_t segNum, ofs;
-
-    auto res = std::from_chars( sym.addr.data(),
-                                sym.addr.data() + sym.addr.size(), segNum, 16 );
-    if( !( res.ec == std::errc() && *res.ptr == ':'))
-        return false;
-
-    res = std::from_chars( res.ptr + 1, sym.addr.data() + sym.addr.size(),
-                           ofs, 16 );
-    if( !( res.ec == std::errc() && *res.ptr == '\0'))
-        return false;
+    uint32_t segNum = KMapParser::addrSeg( sym.addr );
+    uint32_t ofs = KMapParser::addrOfs( sym.addr );
 
     // update maximum length of the symbol names
     auto len = sym.name.size();
@@ -371,172 +589,503 @@ bool KSymWriter::addSymbol( const KMapParser::Public& sym )
     // constants ?
     if( segNum == SEG0 )
     {
-        auto it = _segments.find( SEG0 );
+        auto& consts = segmentAt( SEG0 );
+
+        if( consts.name.empty())
+            consts.name = "<Constants>";
+
+        _nConsts++;
 
-        if( it == _segments.end())
-            _segments[ SEG0 ] = {"<Constants>", 0 };
+        // keep them while they may fit in the header block. 16-bit sizes
+        // and no module name are the least
+        auto symSize = calcSymSize( AddrType::Bit16, sym.name );
 
-        _consts.push_back({ ofs, sym.name });
+        if( consts.nKept + 1 == _nConsts
+            && calcFirstSymOfs( sizeof( SymHeader ), "")
+                + _constsSize + symSize <= MaxBlockSize )
+        {
+            keepSymbol( SEG0, ofs, sym.name );
+            _constsSize += symSize;
+        }
 
-        if( _segments[ SEG0 ].length < ofs )
-            _segments[ SEG0 ].length = ofs;
+        if( consts.length < ofs )
+            consts.length = ofs;
 
         return true;
     }
 
     // no registered segments ?
-    if( _segSymsMap.find( segNum ) == _segSymsMap.end())
+    if( segNum >= _segments.size() || !_segments[ segNum ].defined )
         return false;
 
-    _segSymsMap[ segNum ].push_back({ ofs, sym.name });
+    auto& seg = _segments[ segNum ];
+
+    // placed after all the symbols added so far ?
+    bool last = segNum >= _lastSegNum;
+    if( last )
+        _lastSegNum = segNum;
+
+    tallySymbol( seg, calcSymSize( l2a( seg.length ), sym.name ));
+
+    // symbols after the ones not kept are not kept, either
+    if( _dropSegNum != SEG0 && segNum >= _dropSegNum )
+        return true;
+
+    // cannot fit even without the tables sorted by name ?
+    if( last && _minParas > MaxFileSizePara )
+    {
+        _dropSegNum = segNum;
+
+        return true;
+    }
+
+    keepSymbol( segNum, ofs, sym.name );
 
     return true;
 }
 
-bool KSymWriter::addSegGrp( const KMapParser::Segment& seg, bool grp )
+void KSymWriter::reserve( size_t nSegs, size_t nSyms )
 {
-    uint32_t segNum, segOfs;
-
-    auto res = std::from_chars( seg.addr.data(),
-                                seg.addr.data() + seg.addr.size(), segNum, 16 );
+    // the smallest symbols are of empty names with 16-bit offsets
+    constexpr size_t MaxSyms = MaxFileSizePara * 16
+                               / ( sizeof( uint16_t ) + sizeof( uint8_t )
+                                   + sizeof( uint16_t ));
+
+    // segment numbers are dense from 1
+    _segments.reserve( nSegs + 1 );
+    _syms.reserve( std::min( nSyms, MaxSyms ));
+}
 
-    if( !( res.ec == std::errc() && *res.ptr == ':'))
-        return false;
+bool KSymWriter::addSegGrp( const KMapParser::Segment& seg, bool grp )
+{
+    uint32_t segNum = KMapParser::addrSeg( seg.addr );
 
     // ignore 0000:xxxxxxxx
     if( segNum == SEG0 )
         return true;
 
-    res = std::from_chars( res.ptr + 1, seg.addr.data() + seg.addr.size(),
-                           segOfs, 16 );
-    if( !( res.ec == std::errc() && *res.ptr == '\0'))
-        return false;
+    uint32_t segOfs = KMapParser::addrOfs( seg.addr );
+    uint32_t segLen = seg.length;
 
-    uint32_t segLen;
+    auto& segment = segmentAt( segNum );
 
-    res = std::from_chars( seg.length.data(),
-                           seg.length.data() + seg.length.size(), segLen, 16 );
-    if( !( res.ec == std::errc() && *res.ptr == '\0'))
-        return false;
-
-    auto it = _segments.find( segNum );
-
-    if( it == _segments.end())
+    if( !segment.defined )
     {
-        _segments[ segNum ] = { seg.name, segOfs + segLen };
-        _segSymsMap[ segNum ] = {};
+        segment.name = seg.name;
+        segment.length = segOfs + segLen;
+        segment.defined = true;
     }
     else
     {
-        if( grp && _segments[ segNum ].name.compare( seg.name ) != 0 )
+        auto nameLen = segment.name.size();
+        auto addrType = l2a( segment.length );
+
+        if( grp && segment.name.compare( seg.name ) != 0 )
         {
             verb.info() << seg.name << " (grp) redefines "
-                        << _segments[ segNum ].name << " (seg)\n";
+                        << segment.name << " (seg)\n";
 
-            _segments[ segNum ].name = seg.name;
+            segment.name = seg.name;
         }
 
-        if( it->second.length < segOfs + segLen )
-            it->second.length = segOfs + segLen;
+        if( segment.length < segOfs + segLen )
+            segment.length = segOfs + segLen;
+
+        // sizes of the symbols added changed ?
+        if(( segment.name.size() != nameLen
+             || l2a( segment.length ) != addrType )
+           && segment.nSyms > 0 )
+            retally( segNum );
     }
 
     return true;
 }
 
-bool KSymWriter::writeSymbols( size_t segNum, const Symbols& symbols,
-                               size_t firstSymOfs )
+void KSymWriter::keepSymbol( uint32_t segNum, uint32_t ofs,
+                             std::string_view name )
 {
-    if( symbols.empty())
-        return true;
+    if( !_syms.empty() && segNum < _syms.back().segNum )
+        _symsInOrder = false;
+
+    _syms.push_back({ ofs, segNum, static_cast< uint32_t >( _names.size()),
+                      static_cast< uint32_t >( name.size())});
+    _names.append( name );
+
+    _segments[ segNum ].nKept++;
+}
+
+void KSymWriter::tallySymbol( Segment& seg, size_t symSize )
+{
+    auto symOfs = calcFirstSymOfs( sizeof( SegmentInfo ), seg.name );
+
+    // the last block is full ? then start a new block
+    if( seg.lastSyms > 0 && symOfs + seg.lastSize + symSize > MaxBlockSize )
+    {
+        for( bool byName: { false, true })
+            seg.paras[ byName ] += b2p( calcBlockSize( symOfs, seg.lastSyms,
+                                                       seg.lastSize,
+                                                       byName ));
 
-    auto addrType = l2a( _segments[ segNum ].length );
-    auto segName{ _segments[ segNum ].name };
+        seg.lastSyms = 0;
+        seg.lastSize = 0;
+    }
+
+    if( seg.lastSyms == 0 )
+        seg.nBlocks++;
+
+    seg.nSyms++;
+    seg.symSize += symSize;
+    seg.lastSyms++;
+    seg.lastSize += symSize;
+
+    _minParas -= seg.minParas;
+
+    seg.minParas = seg.paras[ false ]
+                   + b2p( calcBlockSize( symOfs, seg.lastSyms, seg.lastSize,
+                                         false ));
+
+    _minParas += seg.minParas;
+}
+
+void KSymWriter::retally( size_t segNum )
+{
+    auto& seg = _segments[ segNum ];
+    auto addrType = l2a( seg.length );
+    size_t nDropped = seg.nSyms - seg.nKept;
+
+    _minParas -= seg.minParas;
+
+    // clear the tallies only
+    seg = { std::move( seg.name ), seg.length, seg.defined, seg.first,
+            seg.nKept };
+
+    for( const auto& sym: _syms )
+    {
+        if( sym.segNum == segNum )
+            tallySymbol( seg, calcSymSize( addrType, symName( sym )));
+    }
+
+    seg.nSyms += nDropped;
+}
+
+void KSymWriter::listSymbols( size_t segNum ) const
+{
+    const auto& seg = _segments[ segNum ];
+
+    if( seg.nKept == 0 )
+        return;
+
+    auto addrType = l2a( seg.length );
+    const auto& segName = seg.name;
 
     verb.info() << segName << std::setw( 21 - segName.size() )
-                << symbols.size() << " "
+                << seg.nKept << " "
                 << ( addrType == AddrType::Bit32 ? 32: 16 ) << "-bit symbol";
-    if( symbols.size() > 1 )
+    if( seg.nKept > 1 )
         verb.info() << "s";
     verb.info() << "\n";
 
-    for( const auto& sym: symbols )
+    if( !verb.isDebug())
+        return;
+
+    for( size_t i = seg.first; i < seg.first + seg.nKept; i++ )
     {
+        const auto& sym = _syms[ i ];
+
         verb.debug() << std::setfill('0') << std::setw( 4 ) << segNum << ":"
                      << std::setw( 8 ) << std::hex << sym.addr << std::dec << " "
-                     << sym.name << "\n";
+                     << symName( sym ) << "\n";
     }
 
     verb.debug() << std::setfill(' ') << "\n";
+}
+
+/**
+ * Get the source file name to write to .SYM file
+ *
+ * @param[in] file  Source file
+ * @return          Name truncated to 255 characters
+ */
+static inline std::string_view lineFileName( const KLineTable::File& file )
+{
+    return file.name.substr( 0, 0xFF );
+}
 
-    using SymOfsPair = std::pair< size_t, std::string >;
-    std::vector< SymOfsPair > symOfsTbl;
+size_t KSymWriter::layOutLines( std::vector< LineBlock >& lineBlocks,
+                                size_t fileSizePara ) const
+{
+    // source files by segment number
+    std::vector< std::vector< const KLineTable::File * >> segFiles(
+                                                            _segments.size());
+    size_t nSkipped = 0;
+    size_t nWide = 0;
+    size_t nDropped = 0;
+
+    for( const auto& file: _lines->files())
+    {
+        // no segment to attach to
+        if( !hasSymbols( file.segNum ))
+        {
+            nSkipped += file.count;
+            continue;
+        }
 
-    // write symbols and build symbol offset table sorted by address
-    auto symOfs = firstSymOfs;
+        // line numbers are 16-bit
+        nWide += file.nWide;
+
+        segFiles[ file.segNum ].push_back( &file );
+    }
+
+    if( nSkipped > 0 )
+        verb.info() << nSkipped << " line numbers in segments without "
+                       "symbols are skipped\n";
 
-    for( const auto& sym: symbols )
+    size_t paras = fileSizePara;
+
+    for( size_t segNum = SEG0 + 1; segNum < segFiles.size(); segNum++ )
     {
-        symOfsTbl.push_back( std::make_pair( symOfs, sym.name ));
+        const auto& files = segFiles[ segNum ];
 
-        if( addrType == AddrType::Bit32 )
+        if( files.empty())
+            continue;
+
+        size_t lineSize = ( l2a( _segments[ segNum ].length )
+                            == AddrType::Bit32 ?
+                            sizeof( uint32_t ) : sizeof( uint16_t ))
+                          + sizeof( uint16_t );
+        size_t firstOfLines = lineBlocks.size();
+
+        for( auto file: files )
         {
-            write32( sym.addr );
-            symOfs += sizeof( uint32_t );
+            size_t linesOfs = sizeof( LineDef ) + sizeof( uint8_t )
+                              + lineFileName( *file ).size();
+
+            // offsets of lines and # of lines are 16-bit
+            size_t maxLines = std::min< size_t >(
+                                ( MaxBlockSize - linesOfs ) / lineSize,
+                                0xFFFF );
+
+            size_t nLines = file->count - file->nWide;
+
+            for( size_t first = 0; first < nLines; first += maxLines )
+            {
+                size_t count = std::min( nLines - first, maxLines );
+
+                size_t blockParas = ( linesOfs + count * lineSize + 15 ) / 16;
+
+                // keep line defs which fit
+                if( paras + blockParas > MaxFileSizePara )
+                {
+                    nDropped += count;
+                    continue;
+                }
+
+                lineBlocks.push_back({ file, first, count, paras * 16, 0 });
+                paras += blockParas;
+            }
         }
-        else
+
+        // chain the line defs of a segment
+        for( size_t i = firstOfLines; i + 1 < lineBlocks.size(); i++ )
+            lineBlocks[ i ].next = lineBlocks[ i + 1 ].ofs;
+    }
+
+    if( nWide > 0 )
+    {
+        verb.err() << "Too large line numbers. " << nWide << " of "
+                   << _lines->size() - nSkipped
+                   << " line numbers above 65535 are dropped!!!\n";
+    }
+
+    if( nDropped > 0 )
+    {
+        verb.err() << "Too many line numbers. " << nDropped << " of "
+                   << _lines->size() - nSkipped
+                   << " line numbers are dropped!!!\n";
+    }
+
+    return paras;
+}
+
+void KSymWriter::writeLines( const std::vector< LineBlock >& lineBlocks )
+{
+    // lines of the current source file in order of offset
+    std::vector< std::pair< uint32_t, uint32_t >> lines;
+    const KLineTable::File *file = nullptr;
+
+    for( const auto& lineBlock: lineBlocks )
+    {
+        if( lineBlock.file != file )
         {
-            write16( sym.addr );
-            symOfs += sizeof( uint16_t );
+            file = lineBlock.file;
+
+            lines.clear();
+            lines.reserve( file->count - file->nWide );
+
+            // drop line numbers above 16 bits as layOutLines() does
+            _lines->forEachLine( *file, [ & ]( uint32_t line, uint32_t ofs )
+            {
+                if( line <= 0xFFFF )
+                    lines.emplace_back( ofs, line );
+            });
+
+            std::stable_sort( lines.begin(), lines.end(),
+                              []( const auto& a, const auto& b )
+            {
+                return a.first < b.first;
+            });
+
+            verb.info() << lineFileName( *file )
+                        << std::setw( 21 - std::min< size_t >(
+                                               lineFileName( *file ).size(),
+                                               20 ))
+                        << lines.size() << " line number";
+            if( lines.size() > 1 )
+                verb.info() << "s";
+            verb.info() << "\n";
         }
 
-        writeStr( sym.name );
-        symOfs += sizeof( uint8_t ) + sym.name.size();
+        auto addrType = l2a( _segments[ file->segNum ].length );
+        auto name = lineFileName( *file );
+
+        LineDef lineDef{};
+
+        lineDef.nextLineDefPara = lineBlock.next / 16;
+        lineDef.linesOfs = sizeof( lineDef ) + sizeof( uint8_t ) + name.size();
+        lineDef.nLines = lineBlock.count;
+
+        Cursor cur{ _image.data() + lineBlock.ofs };
+
+        cur.writeData( &lineDef, sizeof( lineDef ));
+        cur.writeStr( name );
+
+        for( size_t i = lineBlock.first;
+             i < lineBlock.first + lineBlock.count; i++ )
+        {
+            KVERBOSE_DEBUG << std::setfill('0') << std::setw( 4 )
+                           << file->segNum << ":" << std::setw( 8 )
+                           << std::hex << std::uppercase
+                           << lines[ i ].first << std::dec
+                           << std::nouppercase << std::setfill(' ')
+                           << " line "
+                           << lines[ i ].second << "\n";
+
+            if( addrType == AddrType::Bit32 )
+                cur.write32( lines[ i ].first );
+            else
+                cur.write16( lines[ i ].first );
+
+            cur.write16( lines[ i ].second );
+        }
     }
+}
 
-    // write symbol offset table sorted by value
-    for( const auto& sym: symOfsTbl )
-        write16( sym.first );
+void KSymWriter::reportLimits( const Block& consts,
+                               size_t fileSizePara ) const
+{
+    // percentage of a limit
+    auto usage = []( size_t n, size_t limit )
+    {
+        return n * 100 / limit;
+    };
+
+    verb.out() << "Limits of " << _symFileName << ":\n"
+               << "Segment               Symbols      Bytes  Blocks  Usage\n";
+
+    auto report = [ & ]( const std::string& segName, size_t nSyms,
+                         size_t bytes, size_t nBlocks )
+    {
+        verb.out() << std::left << std::setw( 20 ) << segName << std::right
+                   << std::setw( 8 ) << nSyms << std::setw( 11 ) << bytes
+                   << std::setw( 8 ) << nBlocks << std::setw( 6 )
+                   << usage( bytes, MaxBlockSize ) << "%\n";
+    };
+
+    report("<Constants>", consts.nSyms, consts.symOfs + consts.symSize, 1 );
+
+    for( size_t segNum = SEG0 + 1; segNum < _segments.size(); segNum++ )
+    {
+        const auto& seg = _segments[ segNum ];
+
+        if( seg.nSyms == 0 )
+            continue;
 
-    if( _omitAlphaSort )
+        report( seg.name, seg.nSyms,
+                calcFirstSymOfs( sizeof( SegmentInfo ), seg.name )
+                + seg.symSize, seg.nBlocks );
+    }
+
+    verb.out() << "File size: " << fileSizePara << " of " << MaxFileSizePara
+               << " paragraphs (" << usage( fileSizePara, MaxFileSizePara )
+               << "%)\n";
+}
+
+bool KSymWriter::writeSymbols( Cursor& cur, const Block& block,
+                               bool byName ) const
+{
+    if( block.nSyms == 0 )
         return true;
 
-    // compare strings case-insensitively by converting to lowercase
-    auto nameCmp = []( const auto& a, const auto& b )
+    auto addrType = l2a( _segments[ block.segNum ].length );
+
+    std::vector< uint16_t > symOfsTbl;
+
+    symOfsTbl.reserve( block.nSyms );
+
+    // write symbols and build symbol offset table sorted by address
+    auto symOfs = block.symOfs;
+
+    for( size_t i = 0; i < block.nSyms; i++ )
     {
-        std::string_view aname;
-        std::string_view bname;
-        std::string la;
-        std::string lb;
+        const auto& sym = block.syms[ i ];
 
-        using T = std::decay_t< decltype( a )>;
+        symOfsTbl.push_back( symOfs );
 
-        if constexpr( std::is_same_v< T, Symbol >)
+        if( addrType == AddrType::Bit32 )
         {
-            aname = a.name;
-            bname = b.name;
+            cur.write32( sym.addr );
+            symOfs += sizeof( uint32_t );
         }
         else
         {
-            aname = a.second;
-            bname = b.second;
+            cur.write16( sym.addr );
+            symOfs += sizeof( uint16_t );
         }
 
-        la.resize( aname.size());
-        lb.resize( bname.size());
+        auto name = symName( sym );
 
-        std::transform( aname.begin(), aname.end(), la.begin(), ::tolower );
-        std::transform( bname.begin(), bname.end(), lb.begin(), ::tolower );
+        cur.writeStr( name );
+        symOfs += sizeof( uint8_t ) + name.size();
+    }
 
-        auto cmp = la.compare( lb );
-        return cmp < 0 || ( cmp == 0 && aname.compare( bname ) < 0 );
-    };
+    // write symbol offset table sorted by value
+    for( auto ofs: symOfsTbl )
+        cur.write16( ofs );
+
+    if( !byName )
+        return true;
+
+    // compare strings case-insensitively by converting to lowercase
+    KCollation coll( KCollation::Fold::Lower );
+
+    std::vector< uint32_t > order( block.nSyms );
+
+    for( uint32_t i = 0; i < order.size(); i++ )
+        order[ i ] = i;
 
     // sort symbol offset table by name
-    std::sort( symOfsTbl.begin(), symOfsTbl.end(), nameCmp );
+    {
+        KStats::Timer timer( KStats::Phase::Sort );
+
+        coll.sort( order, [ & ]( uint32_t i ) -> std::string_view
+        {
+            return symName( block.syms[ i ]);
+        });
+    }
 
     // write symbol offset table sorted by name
-    for( const auto& sym: symOfsTbl )
-        write16( sym.first );
+    for( auto i: order )
+        cur.write16( symOfsTbl[ i ]);
 
     return true;
 }
@@ -18,14 +18,16 @@
 #define KMAPSYM_KSYMWRITER_H
 
 #include "kmapparser.h"
+#include "klinetable.h"
+#include "kthreadpool.h"
 
 #include <fstream>
 #include <string>
 #include <string_view>
 #include <vector>
-#include <map>
 
 #include <cstdint>
+#include <cstring>
 
 /**
  * .SYM writer class
@@ -49,9 +51,19 @@ public:
      * Open a .SYM file to write
      *
      * @param[in] symFileName   .SYM file name to open
+     * @param[in] dir           Directory of @p symFileName if relative.
+     *                          Empty for the current directory. Messages
+     *                          show @p symFileName as it is
      * @return                  true if succeeds, otherwise false
+     * @remark                  Keeps the records added. So they can be added
+     *                          before the .SYM file is opened
      */
-    bool open( std::string_view symFileName = {});
+    bool open( std::string_view symFileName = {}, std::string_view dir = {});
+
+    /**
+     * Forget the records added to reuse a writer
+     */
+    void clear();
 
     /**
      * Close a .SYM file
@@ -83,6 +95,13 @@ public:
      */
     bool setEntryPoint( std::string_view entryPoint );
 
+    /**
+     * Set a thread pool to write segments in parallel
+     *
+     * @param[in] pool  Thread pool to use. nullptr to write serially
+     */
+    void setThreadPool( KThreadPool *pool ) { _pool = pool; }
+
     /**
      * Set the flag to omit alphabetical sorting of symbols
      */
@@ -91,6 +110,23 @@ public:
         _omitAlphaSort = omitAlphaSort;
     }
 
+    /**
+     * Set line numbers to write
+     *
+     * @param[in] lines     Line numbers. Should be valid until write()
+     *                      returns. nullptr not to write line numbers
+     */
+    void setLineTable( const KLineTable *lines ) { _lines = lines; }
+
+    /**
+     * Set the flag to report how close segments are to the limits of the
+     * .SYM format
+     */
+    void setReportLimits( bool reportLimits )
+    {
+        _reportLimits = reportLimits;
+    }
+
     /**
      * Add group to a segment list
      *
@@ -99,8 +135,7 @@ public:
      */
     bool addGroup( const KMapParser::Group& grp )
     {
-        return addSegGrp({ grp.addr, grp.length.empty() ? "0" : grp.length,
-                           grp.name}, true );
+        return addSegGrp({ grp.addr, grp.length, grp.name, {}, 0 }, true );
     }
 
 
@@ -121,17 +156,49 @@ public:
      *
      * @param[in] sym   Symbol to add
      * @return          true if succeeds, otherwise false
+     * @remark          A symbol which cannot fit in .SYM file any more is
+     *                  counted, but not kept. So the memory is bounded by
+     *                  the limits of .SYM format if symbols are added in
+     *                  order of address. Segments and groups should be
+     *                  added before symbols
      */
     bool addSymbol( const KMapParser::Public & sym );
 
+    /**
+     * Reserve memory for segments and symbols to add
+     *
+     * @param[in] nSegs     # of segments and groups
+     * @param[in] nSyms     # of symbols
+     * @remark              Not more symbols than .SYM file can keep are
+     *                      reserved
+     */
+    void reserve( size_t nSegs, size_t nSyms );
+
 private:
     /**
      * Segment structure
+     *
+     * The blocks of all the symbols added are tallied, even if some of them
+     * are not kept.
      */
     struct Segment
     {
-        std::string name;   ///< name of the segment
-        uint32_t length;    ///< length of the segment
+        std::string name;       ///< name of the segment
+        uint32_t length = 0;    ///< length of the segment
+        bool defined = false;   ///< added by addSegment() or addGroup()
+        size_t first = 0;       ///< index of the first symbol kept in _syms.
+                                ///< valid while writing
+        size_t nKept = 0;       ///< # of symbols kept
+        size_t nSyms = 0;       ///< # of symbols added
+        size_t symSize = 0;     ///< size of symbols added in bytes
+        size_t nBlocks = 0;     ///< # of blocks of symbols added
+        size_t lastSyms = 0;    ///< # of symbols in the last block
+        size_t lastSize = 0;    ///< size of symbols in the last block
+        size_t paras[ 2 ] = {}; ///< paragraphs of the blocks except the
+                                ///< last one, without and with the table
+                                ///< sorted by name
+        size_t minParas = 0;    ///< paragraphs of all the blocks without
+                                ///< the table sorted by name
     };
 
     /**
@@ -140,7 +207,9 @@ private:
     struct Symbol
     {
         uint32_t addr;      ///< address of the symbol
-        std::string name;   ///< name of the symbol
+        uint32_t segNum;    ///< segment number of the symbol
+        uint32_t nameOfs;   ///< offset of the name in _names
+        uint32_t nameLen;   ///< length of the name
     };
 
     static constexpr uint32_t SEG0 = 0; ///< segment number of constants
@@ -148,21 +217,53 @@ private:
     std::string _symFileName;   ///< .SYM file name
     std::ofstream _ofs;         ///< file stream for writing
 
+    std::vector< char > _image; ///< whole .SYM file image
+
+    KThreadPool *_pool = nullptr;   ///< thread pool to write in parallel
+
     std::string _moduleName;    ///< module name
-    uint16_t _entrySegNum;      ///< segment number containing the entry point
+    uint16_t _entrySegNum = 0;  ///< segment number containing the entry point
 
     bool _omitAlphaSort = false;    ///< flag to omit alphabetical sorting
+    bool _reportLimits = false;     ///< flag to report usage of the limits
 
-    std::map< size_t, Segment > _segments;  ///< segment list
+    /// segments by segment number. SEG0 for constants
+    std::vector< Segment > _segments;
 
-    using Symbols = std::vector< Symbol >;
-    using SegmentSymbolsMap = std::map< size_t, Symbols >;
+    std::vector< Symbol > _syms;    ///< symbols kept in order of addition
+    std::string _names;             ///< names of the symbols kept
+    bool _symsInOrder = true;       ///< _syms in order of segment number
 
-    Symbols _consts;                ///< constant list
-    SegmentSymbolsMap _segSymsMap;  ///< symbol list
+    size_t _nConsts = 0;            ///< # of constants added
+    size_t _constsSize = 0;         ///< min. size of constants kept in bytes
+
+    /// paragraphs of the blocks of all the segments without the tables
+    /// sorted by name
+    size_t _minParas = 0;
+    size_t _lastSegNum = 0;     ///< max. segment number of symbols added
+    size_t _dropSegNum = 0;     ///< first segment number with symbols not
+                                ///< kept. 0 if none
 
     size_t _maxSymNameLen = 0;  ///< max length of symbol names
 
+    const KLineTable *_lines = nullptr;     ///< line numbers to write
+
+    /**
+     * Block of .SYM file
+     *
+     * Header with constants, or symbols of a segment. A segment with too many
+     * symbols for a block is split into several blocks
+     */
+    struct Block
+    {
+        size_t segNum;          ///< segment number
+        const Symbol *syms;     ///< first symbol of the block
+        size_t nSyms;           ///< # of symbols
+        size_t symOfs;          ///< offset of the first symbol in the block
+        size_t symSize;         ///< size of symbols in bytes
+        size_t ofs;             ///< offset of the block in the image
+    };
+
     /**
      * Add segment or group to a segment list
      *
@@ -173,77 +274,197 @@ private:
     bool addSegGrp( const KMapParser::Segment& seg, bool grp );
 
     /**
-     * Write binary data to .SYM file
+     * Get a segment, growing the segment table if needed
      *
-     * @param[in] data  Data to write
-     * @param[in] n     Size of data to write
-     * @return          true if succeeds, otherwise false
+     * @param[in] segNum    Segment number
+     * @return              Segment of @p segNum
      */
-    bool writeData( const void *data, size_t n )
+    Segment& segmentAt( size_t segNum )
     {
-        return static_cast< bool >(
-                    _ofs.write( reinterpret_cast< const char * >( data ), n ));
+        if( _segments.size() <= segNum )
+            _segments.resize( segNum + 1 );
+
+        return _segments[ segNum ];
     }
 
     /**
-     * Write 8-bit value to .SYM file
+     * Check if a segment has symbols to write
      *
-     * @param[in] u8    8-bit value to write
-     * @return          true if succeeds, otherwise false
+     * @param[in] segNum    Segment number
+     * @return              true if @p segNum is not SEG0 and has symbols
+     *                      kept, otherwise false
+     */
+    bool hasSymbols( size_t segNum ) const
+    {
+        return segNum != SEG0 && segNum < _segments.size()
+               && _segments[ segNum ].nKept > 0;
+    }
+
+    /**
+     * Get the name of a symbol
      */
-    bool write8( uint8_t u8 ) { return writeData( &u8, sizeof( u8 )); }
+    std::string_view symName( const Symbol& sym ) const
+    {
+        return { _names.data() + sym.nameOfs, sym.nameLen };
+    }
 
     /**
-     * Write 16-bit value to .SYM file
+     * Keep a symbol
      *
-     * @param[in] u16   16-bit value to write
-     * @return          true if succeeds, otherwise false
+     * @param[in] segNum    Segment number
+     * @param[in] ofs       Offset or value of the symbol
+     * @param[in] name      Name of the symbol
      */
-    bool write16( uint16_t u16 ) { return writeData( &u16, sizeof( u16 )); }
+    void keepSymbol( uint32_t segNum, uint32_t ofs, std::string_view name );
 
     /**
-     * Write 32-bit value to .SYM file
+     * Add a symbol to the tallies of the blocks of a segment
      *
-     * @param[in] u32   32-bit value to write
-     * @return          true if succeeds, otherwise false
+     * @param[in] seg       Segment
+     * @param[in] symSize   Size of the symbol in bytes
      */
-    bool write32( uint32_t u32 ) { return writeData( &u32, sizeof( u32 )); }
+    void tallySymbol( Segment& seg, size_t symSize );
 
     /**
-     * Write string to .SYM file
+     * Tally the blocks of a segment again from the symbols kept
      *
-     * @param[in] sv    String to write
-     * @return          true if succeeds, otherwise false
+     * @param[in] segNum    Segment number
+     * @remark              Called if the name or the length of a segment
+     *                      changes after symbols are added. The symbols
+     *                      not kept are counted, but not tallied any more
      */
-    bool writeStr( std::string_view sv )
+    void retally( size_t segNum );
+
+    /**
+     * Write cursor into a part of .SYM image
+     */
+    struct Cursor
     {
-        return write8( sv.size()) && writeData( sv.data(), sv.size());
-    }
+        char *p;    ///< position to write to
+
+        /**
+         * Write binary data
+         *
+         * @param[in] data  Data to write
+         * @param[in] n     Size of data to write
+         */
+        void writeData( const void *data, size_t n )
+        {
+            std::memcpy( p, data, n );
+            p += n;
+        }
+
+        /**
+         * Write 8-bit value
+         *
+         * @param[in] u8    8-bit value to write
+         */
+        void write8( uint8_t u8 ) { *p++ = u8; }
+
+        /**
+         * Write 16-bit value
+         *
+         * @param[in] u16   16-bit value to write
+         */
+        void write16( uint16_t u16 ) { writeData( &u16, sizeof( u16 )); }
+
+        /**
+         * Write 32-bit value
+         *
+         * @param[in] u32   32-bit value to write
+         */
+        void write32( uint32_t u32 ) { writeData( &u32, sizeof( u32 )); }
+
+        /**
+         * Write string
+         *
+         * @param[in] sv    String to write
+         */
+        void writeStr( std::string_view sv )
+        {
+            write8( sv.size());
+            writeData( sv.data(), sv.size());
+        }
+
+        /**
+         * Write paddings
+         *
+         * @param[in] used      Used bytes to calculate the padding size
+         * @param[in] ch        Char for padding
+         * @param[in] align     Alignment value for padding
+         */
+        void writePadding( size_t used, char ch = '\0', size_t align = 16 )
+        {
+            size_t n = ( align - ( used % align )) % align;
+
+            std::memset( p, ch, n );
+            p += n;
+        }
+    };
 
     /**
-     * Write a symbol list to .SYM file
+     * Line def block of .SYM file
+     *
+     * Lines of a source file in a segment. Too many lines for a block are
+     * split into several blocks
+     */
+    struct LineBlock
+    {
+        const KLineTable::File *file;   ///< source file
+        size_t first;           ///< index of the first line in order of offset
+        size_t count;           ///< # of lines
+        size_t ofs;             ///< offset of the block in the image
+        size_t next;            ///< offset of the next block of the segment.
+                                ///< 0 if last
+    };
+
+    /**
+     * Lay out line numbers after segments
+     *
+     * @param[out] lineBlocks   Blocks laid out
+     * @param[in]  fileSizePara Size of .SYM file without line numbers in
+     *                          paragraphs
+     * @return                  Size of .SYM file with line numbers in
+     *                          paragraphs
+     * @remark                  Drops line defs which do not fit
+     */
+    size_t layOutLines( std::vector< LineBlock >& lineBlocks,
+                        size_t fileSizePara ) const;
+
+    /**
+     * Write line numbers to .SYM image
+     *
+     * @param[in] lineBlocks    Blocks laid out by layOutLines()
+     */
+    void writeLines( const std::vector< LineBlock >& lineBlocks );
+
+    /**
+     * Print the symbols kept of a segment verbosely
      *
      * @param[in] segNum        Segment number
-     * @param[in] symbols       Symbols to write
-     * @param[in] firstOfs      Offset to write the first symbol
-     * @return                  true if succeeds, otherwise false
      */
-    bool writeSymbols( size_t segNum, const Symbols& symbols, size_t firstOfs );
+    void listSymbols( size_t segNum ) const;
 
     /**
-     * Write paddings to .SYM file
+     * Print usage of the limits of .SYM format
      *
-     * @param[in] used      Used bytes to calculate the padding size
-     * @param[in] ch        Char for padding
-     * @param[in] align     Alignment value for padding
-     * @return              true if succeeds, otherwise false
+     * @param[in] consts        Header block with constants
+     * @param[in] fileSizePara  Size of .SYM file in paragraphs
+     * @remark                  Counts all the symbols of segments added
      */
-    bool writePadding( size_t used, char ch = '\0', size_t align = 16 )
-    {
-        std::string padding(( align - ( used % align )) % align, ch );
+    void reportLimits( const Block& consts, size_t fileSizePara ) const;
 
-        return writeData( padding.data(), padding.size());
-    }
+    /**
+     * Write symbols of a block to .SYM image
+     *
+     * @param[in] cur           Cursor to write to
+     * @param[in] block         Block to write
+     * @param[in] byName        true to write the table sorted by name
+     * @return                  true if succeeds, otherwise false
+     * @remark                  Safe to call concurrently for different
+     *                          blocks
+     */
+    bool writeSymbols( Cursor& cur, const Block& block, bool byName ) const;
 };
 
 #endif
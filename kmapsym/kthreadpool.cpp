@@ -0,0 +1,140 @@
+/*
+ * KThreadPool
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "kthreadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+/**
+ * Set of tasks submitted by KThreadPool::run()
+ */
+struct TaskSet
+{
+    const std::function< void( size_t )>& task;     ///< task to run
+    size_t n;                                       ///< # of tasks
+    std::atomic< size_t > next{ 0 };                ///< next task to run
+    size_t done = 0;                                ///< # of completed tasks
+    std::mutex mutex;                               ///< mutex for done
+    std::condition_variable cv;                     ///< notify completion
+
+    /**
+     * Constructor
+     *
+     * @param[in] t     Task to run
+     * @param[in] count # of tasks
+     */
+    TaskSet( const std::function< void( size_t )>& t, size_t count )
+        : task( t ), n( count ) {}
+
+    /**
+     * Run tasks until no tasks remain
+     */
+    void work()
+    {
+        size_t completed = 0;
+
+        for( size_t i; ( i = next++ ) < n; )
+        {
+            task( i );
+            ++completed;
+        }
+
+        if( completed > 0 )
+        {
+            std::lock_guard< std::mutex > lock( mutex );
+
+            done += completed;
+            if( done == n )
+                cv.notify_all();
+        }
+    }
+};
+
+KThreadPool::KThreadPool( size_t nThreads )
+{
+    if( nThreads == 0 )
+        nThreads = std::thread::hardware_concurrency();
+
+    for( size_t i = 1; i < nThreads; i++ )
+        _threads.emplace_back( &KThreadPool::worker, this );
+}
+
+KThreadPool::~KThreadPool()
+{
+    {
+        std::lock_guard< std::mutex > lock( _mutex );
+
+        _stop = true;
+    }
+
+    _cv.notify_all();
+
+    for( auto& thread: _threads )
+        thread.join();
+}
+
+void KThreadPool::run( size_t n, const std::function< void( size_t )>& task )
+{
+    if( n == 0 )
+        return;
+
+    auto set = std::make_shared< TaskSet >( task, n );
+
+    // let idle workers help
+    size_t helpers = std::min( n - 1, _threads.size());
+
+    if( helpers > 0 )
+    {
+        {
+            std::lock_guard< std::mutex > lock( _mutex );
+
+            for( size_t i = 0; i < helpers; i++ )
+                _queue.push_back([ set ] { set->work(); });
+        }
+
+        _cv.notify_all();
+    }
+
+    set->work();
+
+    std::unique_lock< std::mutex > lock( set->mutex );
+
+    set->cv.wait( lock, [ &set ] { return set->done == set->n; });
+}
+
+void KThreadPool::worker()
+{
+    for(;;)
+    {
+        std::function< void()> job;
+
+        {
+            std::unique_lock< std::mutex > lock( _mutex );
+
+            _cv.wait( lock, [ this ] { return _stop || !_queue.empty(); });
+
+            if( _stop && _queue.empty())
+                return;
+
+            job = std::move( _queue.front());
+            _queue.pop_front();
+        }
+
+        job();
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ * KThreadPool
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KTHREADPOOL_H
+#define KMAPSYM_KTHREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <cstddef>
+
+/**
+ * Fixed-size thread pool
+ */
+class KThreadPool
+{
+public:
+    /**
+     * Constructor
+     *
+     * @param[in] nThreads  # of threads including the calling thread.
+     *                      0 for the # of hardware threads
+     */
+    explicit KThreadPool( size_t nThreads = 0 );
+
+    /**
+     * Destructor
+     */
+    ~KThreadPool();
+
+    /**
+     * Copy constructor
+     */
+    KThreadPool( const KThreadPool& ) = delete;
+
+    /**
+     * operator=
+     */
+    KThreadPool& operator=( const KThreadPool& ) = delete;
+
+    /**
+     * Get the # of threads including the calling thread
+     */
+    size_t size() const { return _threads.size() + 1; }
+
+    /**
+     * Run tasks in parallel, and wait for all of them to complete
+     *
+     * @param[in] n     # of tasks
+     * @param[in] task  Task to run. Called with 0 to @p n - 1
+     * @remark          The calling thread runs tasks, too. So it is safe to
+     *                  call in a task.
+     */
+    void run( size_t n, const std::function< void( size_t )>& task );
+
+private:
+    std::vector< std::thread > _threads;            ///< worker threads
+    std::deque< std::function< void()>> _queue;     ///< queue of jobs
+    std::mutex _mutex;                              ///< mutex for _queue
+    std::condition_variable _cv;                    ///< notify new jobs
+    bool _stop = false;                             ///< stop indicator
+
+    /**
+     * Thread function of workers
+     */
+    void worker();
+};
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * KTokenizer
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#include "ktokenizer.h"
+
+#include <cstdint>
+
+#if defined( __AVX2__ ) || defined( __SSE2__ )
+#include <immintrin.h>
+#endif
+
+size_t KTokenizer::split( std::string_view line )
+{
+    const char *p = line.data();
+    size_t len = line.size();
+
+    _count = 0;
+    _leadingSpace = len > 0 && p[ 0 ] == ' ';
+
+    uint32_t prev = 0;      // 1 if the previous byte is not a space
+    size_t start = 0;       // start of the current token
+
+    // Find token boundaries in a block. A bit of nonSpaces is set for each
+    // non-space byte. A boundary is where a bit differs from the previous one.
+    auto scan = [ & ]( uint32_t nonSpaces, size_t base, unsigned width )
+    {
+        uint32_t mask = width == 32 ? ~0U : ( 1U << width ) - 1;
+        uint32_t bounds = ( nonSpaces ^ (( nonSpaces << 1 ) | prev )) & mask;
+
+        while( bounds )
+        {
+            size_t pos = base + __builtin_ctz( bounds );
+
+            // boundaries alternate between start and end of tokens
+            prev ^= 1;
+
+            if( prev )
+                start = pos;
+            else
+                add({ p + start, pos - start });
+
+            bounds &= bounds - 1;
+        }
+
+        prev = ( nonSpaces >> ( width - 1 )) & 1;
+    };
+
+    size_t i = 0;
+
+#if defined( __AVX2__ )
+    const __m256i spaces32 = _mm256_set1_epi8(' ');
+
+    for( ; i + 32 <= len; i += 32 )
+    {
+        __m256i block = _mm256_loadu_si256(
+                            reinterpret_cast< const __m256i * >( p + i ));
+        uint32_t nonSpaces = ~static_cast< uint32_t >(
+            _mm256_movemask_epi8( _mm256_cmpeq_epi8( block, spaces32 )));
+
+        scan( nonSpaces, i, 32 );
+    }
+#endif
+
+#if defined( __SSE2__ )
+    const __m128i spaces16 = _mm_set1_epi8(' ');
+
+    for( ; i + 16 <= len; i += 16 )
+    {
+        __m128i block = _mm_loadu_si128(
+                            reinterpret_cast< const __m128i * >( p + i ));
+        uint32_t nonSpaces = ~static_cast< uint32_t >(
+            _mm_movemask_epi8( _mm_cmpeq_epi8( block, spaces16 ))) & 0xFFFF;
+
+        scan( nonSpaces, i, 16 );
+    }
+#endif
+
+    // the rest, or all if no SIMD
+    while( i < len )
+    {
+        unsigned width = len - i < 32 ? len - i : 32;
+        uint32_t nonSpaces = 0;
+
+        for( unsigned j = 0; j < width; j++ )
+        {
+            if( p[ i + j ] != ' ')
+                nonSpaces |= 1U << j;
+        }
+
+        scan( nonSpaces, i, width );
+
+        i += width;
+    }
+
+    // the last token reaching the end of the line
+    if( prev )
+        add({ p + start, len - start });
+
+    return _count;
+}
@@ -0,0 +1,110 @@
+/*
+ * KTokenizer
+ *
+ * Copyright (C) 2026 KO Myung-Hun <komh78@gmail.com>
+ *
+ * This file is a part of K MapSym
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://www.wtfpl.net/ for more details.
+ */
+
+/** @file */
+
+#ifndef KMAPSYM_KTOKENIZER_H
+#define KMAPSYM_KTOKENIZER_H
+
+#include <string_view>
+
+#include <cstddef>
+
+/**
+ * Space-separated line tokenizer
+ *
+ * Tokens are kept in a fixed-size buffer reused across lines. If a line has
+ * more tokens than the buffer can hold, only the first @ref MaxTokens tokens
+ * and the last token are kept, but size() still counts all of them.
+ */
+class KTokenizer
+{
+public:
+    static constexpr size_t MaxTokens = 16; ///< max. # of tokens to keep
+
+    /**
+     * Split a line by spaces
+     *
+     * @param[in] line  Line to split
+     * @return          # of tokens
+     */
+    size_t split( std::string_view line );
+
+    /**
+     * Get the number of tokens
+     */
+    size_t size() const { return _count; }
+
+    /**
+     * Check if there is no token
+     */
+    bool empty() const { return _count == 0; }
+
+    /**
+     * Check if the line starts with a space
+     */
+    bool leadingSpace() const { return _leadingSpace; }
+
+    /**
+     * Get the @p i th token
+     *
+     * @remark @p i should be less than @ref MaxTokens
+     */
+    std::string_view& operator[]( size_t i ) { return _tokens[ i ]; }
+
+    /**
+     * Get the @p i th token
+     *
+     * @remark @p i should be less than @ref MaxTokens
+     */
+    const std::string_view& operator[]( size_t i ) const
+    {
+        return _tokens[ i ];
+    }
+
+    /**
+     * Get the first token
+     */
+    const std::string_view& front() const { return _tokens[ 0 ]; }
+
+    /**
+     * Get the last token
+     */
+    const std::string_view& back() const
+    {
+        return _count <= MaxTokens ? _tokens[ _count - 1 ] : _last;
+    }
+
+private:
+    std::string_view _tokens[ MaxTokens ];  ///< token buffer
+    std::string_view _last;                 ///< last token
+    size_t _count = 0;                      ///< # of tokens
+    bool _leadingSpace = false;             ///< line starts with a space
+
+    /**
+     * Add a token
+     *
+     * @param[in] token Token to add
+     */
+    void add( std::string_view token )
+    {
+        if( _count < MaxTokens )
+            _tokens[ _count ] = token;
+
+        _last = token;
+        ++_count;
+    }
+};
+
+#endif
@@ -18,6 +18,7 @@
 #define KMAPSYM_KVERBOSE_H
 
 #include <iostream>
+#include <optional>
 
 /**
  * KVerbose class
@@ -56,24 +57,54 @@ public:
      KVerbose& operator=( const KVerbose & ) = delete;
 
     /**
-     * Getter of _level
+     * Get the verbose level of the current thread
      */
-    Level level() const { return _level; }
+    Level level() const { return _threadLevel.value_or( _level ); }
 
     /**
      * Setter of _level
      */
     void level( Level lv ) { _level = lv; }
 
+    /**
+     * Set the verbose level of the current thread
+     *
+     * @param[in] lv    Level to use instead of _level. std::nullopt to
+     *                  restore
+     */
+    void threadLevel( std::optional< Level > lv ) { _threadLevel = lv; }
+
+    /**
+     * Check if information messages are printed
+     */
+    bool isInfo() const { return level() >= Level::Info; }
+
+    /**
+     * Check if debug messages are printed
+     */
+    bool isDebug() const { return level() >= Level::Debug; }
+
+    /**
+     * Redirect messages of the current thread
+     *
+     * @param[in] out   Stream to replace std::cout. nullptr to restore
+     * @param[in] err   Stream to replace std::cerr. nullptr to restore
+     */
+    void redirect( std::ostream *out, std::ostream *err )
+    {
+        _out = out;
+        _err = err;
+    }
+
     /**
      * Print messages to std::cout
      */
     std::ostream& out()
     {
-        if( _level >= Level::Normal )
-            return std::cout;
+        if( level() >= Level::Normal )
+            return cout();
 
-        return _nullStream;
+        return nullStream();
     }
 
     /**
@@ -81,10 +112,10 @@ public:
      */
     std::ostream& err()
     {
-        if( _level >= Level::Normal )
-            return std::cerr;
+        if( level() >= Level::Normal )
+            return _err ? *_err : std::cerr;
 
-        return _nullStream;
+        return nullStream();
     }
 
     /**
@@ -92,10 +123,10 @@ public:
      */
     std::ostream& info()
     {
-        if( _level >= Level::Info )
-            return std::cout;
+        if( level() >= Level::Info )
+            return cout();
 
-        return _nullStream;
+        return nullStream();
     }
 
     /**
@@ -103,10 +134,10 @@ public:
      */
     std::ostream& debug()
     {
-        if( _level >= Level::Debug )
-            return std::cout;
+        if( level() >= Level::Debug )
+            return cout();
 
-        return _nullStream;
+        return nullStream();
     }
 
 private:
@@ -121,19 +152,59 @@ private:
         int overflow( int c ) override { return c; }
     };
 
-    NullBuffer _nullBuffer;     ///< null buffer
-    std::ostream _nullStream;   ///< null stream
     Level _level;               ///< Verbose level
 
+    /// verbose level of the current thread replacing _level
+    static inline thread_local std::optional< Level > _threadLevel;
+
+    /// stream replacing std::cout in the current thread
+    static inline thread_local std::ostream *_out = nullptr;
+
+    /// stream replacing std::cerr in the current thread
+    static inline thread_local std::ostream *_err = nullptr;
+
     /**
      * Constructor
      */
     KVerbose( Level level = Level::Normal )
-        : _nullStream( &_nullBuffer )
-        , _level( level )
+        : _level( level )
     {}
+
+    /**
+     * Get std::cout or the stream replacing it
+     */
+    std::ostream& cout() { return _out ? *_out : std::cout; }
+
+    /**
+     * Get the null stream of the current thread
+     */
+    static std::ostream& nullStream()
+    {
+        static thread_local NullBuffer nullBuffer;
+        static thread_local std::ostream nullStream( &nullBuffer );
+
+        return nullStream;
+    }
 };
 
 //extern KVerbose g_verbose;      ///< global instance for verbose
 
+/**
+ * Print information messages like KVerbose::info(), but evaluate the
+ * operands of << only if information messages are printed
+ *
+ * Usage: KVERBOSE_INFO << "name: " << name << "\n";
+ */
+#define KVERBOSE_INFO \
+    if( !KVerbose::instance().isInfo()) {} else KVerbose::instance().info()
+
+/**
+ * Print debug messages like KVerbose::debug(), but evaluate the operands
+ * of << only if debug messages are printed
+ *
+ * Usage: KVERBOSE_DEBUG << "name: " << name << "\n";
+ */
+#define KVERBOSE_DEBUG \
+    if( !KVerbose::instance().isDebug()) {} else KVerbose::instance().debug()
+
 #endif
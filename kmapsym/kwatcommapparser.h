@@ -18,8 +18,10 @@
 #define KMAPSYM_KWATCOMMAPPASER_H
 
 #include "kmapparser.h"
+#include "ktokenizer.h"
 
 #include <string_view>
+#include <filesystem>
 
 /**
  * Watcom .MAP file parser class
@@ -39,14 +41,164 @@ public:
      */
     virtual ~KWatcomMapParser();
 
+    /**
+     * Check if a line may be a part of the body of a publics block
+     *
+     * @param[in] line  Line to check
+     * @return          true if @p line may be a part of the body, otherwise
+     *                  false
+     */
+    static bool isPublicsBody( std::string_view line );
+
+    /**
+     * Check if a line may be a part of the body of a block to skip
+     *
+     * @param[in] st    Parser state of the block
+     * @param[in] line  Line to check
+     * @return          true if @p line cannot start another block,
+     *                  otherwise false
+     * @remark          Called for every line of the blocks skipped, so it
+     *                  looks at the beginning of @p line only
+     */
+    static bool isBlockBody( State st, std::string_view line );
+
+    /**
+     * Parse a line, and pass records to a sink
+     *
+     * @param[in]     line      Line to parse
+     * @param[in]     v         Tokenizer to use
+     * @param[in,out] st        Parser state
+     * @param[in]     sink      Sink to receive records
+     * @return                  true if success, otherwise false
+     */
+    template< typename Sink >
+    static bool parseLineTo( std::string_view line, KTokenizer& v, State& st,
+                             Sink& sink );
+
 private:
     /**
-     * Line parser
+     * Parse a .MAP file, and pass records to the callbacks
      *
-     * @param[in] line  Line to parse
-     * @return          true if success, otherwise false
+     * @return true if success, otherwise false
      */
-    bool parseLine( std::string_view line ) override;
+    bool parseRecords() override;
 };
 
+template< typename Sink >
+bool KWatcomMapParser::parseLineTo( std::string_view line, KTokenizer& v,
+                                    State& st, Sink& sink )
+{
+    if( line.empty())
+        return true;
+
+    // split by space
+    v.split( line );
+
+    if( v.size() == 0 )
+        return false;
+
+    if( v.front().compare("Group") == 0 )
+        st = State::Groups;
+    else if( v.front().compare("Segment") == 0 )
+        st = State::Segments;
+    else if( v.front().compare("Address") == 0 )
+        st = State::PublicsByName;
+    else if( v.front().compare("Symbol") == 0 )
+        st = State::Imports;
+    else if( line.find("Libraries Used") != std::string_view::npos )
+        st = State::None;
+    else if( line.find("Linker Statistics") != std::string_view::npos )
+        st = State::None;
+    else if( !( line[ 0 ] == ' ' || line[ 0 ] == '='
+                || startsWith( line, "* = ") || startsWith( line, "+ = ")
+                || startsWith( line, "Module: ")))
+    {
+        switch( st )
+        {
+            case State::Groups:
+            {
+                if( v.size() != 3 )
+                    return false;
+
+                Addr addr;
+                uint32_t length;
+
+                if( !parseAddr( v[ 1 ], addr ) || !parseHex( v[ 2 ], length ))
+                    return false;
+
+                sink.group({ addr, length, v[ 0 ]});
+                break;
+            }
+
+            case State::Segments:
+            {
+                if( v.size() != 5 )
+                    return false;
+
+                int nBits = 0;  // unknown
+
+                auto len = v[ 3 ].size();
+                if( len == 13 )
+                    nBits = 32;
+                else if( len == 9 )
+                    nBits = 16;
+
+                if( nBits == 0 )
+                    return false;
+
+                Addr addr;
+                uint32_t length;
+
+                if( !parseAddr( v[ 3 ], addr ) || !parseHex( v[ 4 ], length ))
+                    return false;
+
+                sink.segment({ addr, length, v[ 0 ], v[ 1 ], nBits });
+                break;
+            }
+
+            case State::PublicsByName:
+            case State::PublicsByValue:
+            {
+                if( v.size() != 2 )
+                    return false;
+
+                char ch = v[ 0 ].back();
+
+                if( ch == '*' || ch == '+')
+                  v[ 0 ].remove_suffix( 1 );
+
+                Addr addr;
+
+                if( !parseAddr( v[ 0 ], addr ))
+                    return false;
+
+                sink.publicSym({ addr, v[ 1 ]},
+                               State::PublicsByName /* fake */);
+                break;
+            }
+
+            case State::Imports:
+                if( v.size() != 2 )
+                    return false;
+
+                sink.import({ NoAddr, v[ 0 ], v[ 1 ], {}});
+                break;
+
+            case State::None:
+                if( startsWith( line, "Executable Image: "))
+                    sink.module( std::filesystem::path( line.substr( 18 ))
+                                    .stem().string());
+                else if( startsWith( line, "Entry point address: "))
+                    sink.entry( v.back());
+                // fall through
+
+            default:
+                // ignore
+                break;
+        }
+    }
+
+    return true;
+}
+
 #endif